@@ -97,18 +97,28 @@ void OnCollisionHandler(ECS *ecs, CollisionEvent *event) {
          event->other, event->collision.distance);
 }
 
+void OnEnterHandler(ECS *ecs, CollisionEvent *event) {
+  printf("ENTER: Entity %s touched %s\n", EcsEntityData(ecs, event->self)->tag,
+         EcsEntityData(ecs, event->other)->tag);
+}
+
+void OnExitHandler(ECS *ecs, CollisionEvent *event) {
+  printf("EXIT: Entity %s left %s\n", EcsEntityData(ecs, event->self)->tag,
+         EcsEntityData(ecs, event->other)->tag);
+}
+
 void LoadScene(ECS *ecs) {
 
-  AddLayer(ecs, "player");
-  AddLayer(ecs, "disable");
-  LayerDisableAll(ecs, "disable");
+  Layer player = AddLayer(ecs, "player");
+  Layer disable = AddLayer(ecs, "disable");
+  LayerDisableAll(ecs, disable);
 
   // COLLIDER: [SOLID]
   // BODY: [NONE]
   Entity A = EcsEntity(ecs, "A");
   AddComponent(ecs, A, Transform2, TransformPos(-250, 100));
   AddComponent(ecs, A, Collider, ColliderSolid(5, 18));
-  AddComponent(ecs, A, CollisionListener, {OnCollisionHandler});
+  AddComponent(ecs, A, CollisionListener, {.OnCollision = OnCollisionHandler});
   AddScript(ecs, A, ScriptShowData, EcsOnRender);
 
   // COLLIDER: [TRIGGER]
@@ -116,7 +126,9 @@ void LoadScene(ECS *ecs) {
   Entity B = EcsEntity(ecs, "B");
   AddComponent(ecs, B, Transform2, TransformPos(-150, -100));
   AddComponent(ecs, B, Collider, ColliderTrigger(4, 20));
-  AddComponent(ecs, B, CollisionListener, {OnCollisionHandler});
+  AddComponent(ecs, B, CollisionListener,
+               {.OnCollisionEnter = OnEnterHandler,
+                .OnCollisionExit = OnExitHandler});
   AddScript(ecs, B, ScriptShowData, EcsOnRender);
 
   // COLLIDER: [SOLID]
@@ -141,7 +153,7 @@ void LoadScene(ECS *ecs) {
   // BODY: [STATIC]
   // ANOTHER LAYER
   Entity E = EcsEntity(ecs, "E");
-  EntitySetLayer(ecs, E, "disable");
+  EntitySetLayer(ecs, E, disable);
   AddComponent(ecs, E, Transform2, TransformPos(250, 100));
   Collider solid = ColliderSolid(5, 20);
   AddComponent(ecs, E, Collider, solid);
@@ -150,11 +162,11 @@ void LoadScene(ECS *ecs) {
 
   // PLAYER
   Entity P = EcsEntity(ecs, "Player");
-  EntitySetLayer(ecs, P, "player");
+  EntitySetLayer(ecs, P, player);
   AddComponent(ecs, P, Transform2, TransformOrigin);
   Collider colP = ColliderSolid(3, 22);
   AddComponent(ecs, P, Collider, colP);
-  AddComponent(ecs, P, CollisionListener, {OnCollisionHandler});
+  AddComponent(ecs, P, CollisionListener, {.OnCollision = OnCollisionHandler});
   AddComponent(ecs, P, RigidBody, RigidBodyKinematic(50, 1.5f));
   AddScript(ecs, P, ScriptMove, EcsOnUpdate);
   AddScript(ecs, P, ScriptImpulse, EcsOnFixedUpdate);
@@ -39,7 +39,7 @@ int main(void) {
   AddComponent(world, box, Transform2, TransformOrigin);
   AddComponent(world, box, Collider,
                ColliderRect((Rectangle){0, 0, 10, 10}, true));
-  AddComponent(world, box, CollisionListener, {OnGround});
+  AddComponent(world, box, CollisionListener, {.OnCollision = OnGround});
   AddComponent(world, box, RigidBody, RigidBodyDynamic(50, 3));
   AddScript(world, box, ScriptMove, EcsOnFixedUpdate);
 
@@ -4,7 +4,7 @@
 #include <stdio.h>
 
 void printID(ECS *ecs, Entity e) {
-  char *tag = EcsEntityData(ecs, e)->tag;
+  const char *tag = EcsEntityData(ecs, e)->tag;
   printf(" - [%d \"%s\"]\n", e, tag);
 }
 
@@ -22,6 +22,7 @@
  */
 
 #include <ecs/registry.h>
+#include <mem/job.h>
 
 #include <raylib.h>
 #include <raymath.h>
@@ -98,6 +99,44 @@ typedef struct {
  */
 #define TransformLocalPos(x, y) {{0, 0}, {1, 1}, 0, {x, y}, {1, 1}, 0}
 
+/**
+ * Transform of an entity before the last fixed update.
+ *
+ * Fixed updates run at their own rate, so a transform moved by physics only
+ * changes on some frames. The InterpolationSystem saves the transform before
+ * every fixed update, and render systems draw the entity between both states
+ * with TransformInterpolate() for smooth motion at any frame rate.
+ *
+ * @see FixedClock for the interpolation factor
+ */
+typedef struct {
+  Vector2 position; ///< World-space position before the last fixed update
+  float rotation;   ///< World-space rotation before the last fixed update
+} Interpolation;
+
+/**
+ * Blends the previous and current fixed states of a transform.
+ *
+ * @param t Current transform
+ * @param prev State before the last fixed update
+ * @param alpha Blend factor, 0 is prev and 1 is t (see FixedClock)
+ * @return Transform to draw
+ */
+Transform2 TransformInterpolate(Transform2 *t, Interpolation *prev,
+                                float alpha);
+
+/**
+ * Delta hooks for Transform2 component.
+ *
+ * Positions are sent with 1/64 unit precision, rotations with 1/4096 radian
+ * and scales with 1/1024: a few bytes per value instead of four. Registered
+ * with ComponentDelta().
+ *
+ * @see EcsDelta()
+ */
+void TransformEncode(const void *self, Stream *out);
+void TransformDecode(void *self, Stream *in);
+
 // ########## //
 //  COLLIDER  //
 // ########## //
@@ -116,6 +155,7 @@ typedef struct {
   uint8_t vertices; ///< Number of vertices in polygon
   bool overlap;     ///< Collision overlap flag (internal)
   bool solid;       ///< true for solid, false for trigger
+  Rectangle box;    ///< World-space bounding box for broad-phase (internal)
 } Collider;
 
 /**
@@ -190,6 +230,27 @@ Collider ColliderRect(Rectangle rect, bool solid);
  */
 void ColliderDestructor(void *self);
 
+/**
+ * Snapshot hooks for Collider component.
+ *
+ * Save the polygon vertices, load them into new arrays. Registered with
+ * ComponentSerialize().
+ *
+ * @see EcsSnapshot()
+ */
+void ColliderSave(const void *self, Stream *out);
+void ColliderLoad(void *self, Stream *in);
+
+/**
+ * State hash hook for Collider component.
+ *
+ * Hashes the local polygon and the solid flag, not the vertex pointers.
+ * Registered with ComponentHash().
+ *
+ * @see EcsStateHash()
+ */
+void ColliderHash(const void *self, Stream *out);
+
 /**
  * Destructor for Children component.
  *
@@ -200,6 +261,17 @@ void ColliderDestructor(void *self);
  */
 void ChildrenDestructor(void *self);
 
+/**
+ * Snapshot hooks for Children component.
+ *
+ * Save the child list, load it into a new array. Registered with
+ * ComponentSerialize().
+ *
+ * @see EcsSnapshot()
+ */
+void ChildrenSave(const void *self, Stream *out);
+void ChildrenLoad(void *self, Stream *in);
+
 /**
  * Collision data structure.
  *
@@ -211,6 +283,18 @@ typedef struct {
   float distance; ///< Penetration depth (positive = overlapping)
 } Collision;
 
+/**
+ * Contact lifetime states.
+ *
+ * Tells whether a contact started on the current frame, persists from the
+ * previous one or just ended.
+ */
+typedef enum {
+  CollisionEnter = 0, ///< First frame of the contact
+  CollisionStay,      ///< Contact persists from the previous frame
+  CollisionExit       ///< Contact ended, collision holds the last known data
+} CollisionState;
+
 /**
  * Collision event data structure.
  *
@@ -218,9 +302,10 @@ typedef struct {
  * the colliding entities and collision details.
  */
 typedef struct {
-  Entity self;         ///< Entity receiving the collision event
-  Entity other;        ///< Entity being collided with
-  Collision collision; ///< Collision details
+  Entity self;          ///< Entity receiving the collision event
+  Entity other;         ///< Entity being collided with
+  Collision collision;  ///< Collision details
+  CollisionState state; ///< Contact lifetime state
 } CollisionEvent;
 
 /**
@@ -241,10 +326,10 @@ typedef void (*CollisionHandler)(ECS *, CollisionEvent *);
  * collisions.
  */
 typedef struct {
-  // CollisionHandler OnCollisionEnter;  ///< TODO: Collision start handler
-  // CollisionHandler OnCollisionStay;   ///< TODO: Collision continue handler
-  // CollisionHandler OnCollisionExit;   ///< TODO: Collision end handler
-  CollisionHandler OnCollision; ///< Current collision handler
+  CollisionHandler OnCollision;      ///< Current collision handler
+  CollisionHandler OnCollisionEnter; ///< Collision start handler
+  CollisionHandler OnCollisionStay;  ///< Collision continue handler
+  CollisionHandler OnCollisionExit;  ///< Collision end handler
 } CollisionListener;
 
 // ############ //
@@ -271,15 +356,24 @@ typedef enum {
  * Provides realistic physics simulation including forces, impulses,
  * mass, damping, and gravity support. Integrates with collider
  * components for collision response.
+ *
+ * Fast dynamic bodies (projectiles) can set ccd to be swept from their
+ * previous position by the CollisionSystem, so they don't tunnel through
+ * thin colliders.
  */
 typedef struct {
-  float mass;    ///< Object mass (g), 0 or INFINITY for static objects
-  float invmass; ///< Inverse mass (1/mass), 0 for static objects
-  float damping; ///< Velocity damping factor (0 = no damping)
-  BodyType type; ///< Physics behavior type
-  bool gravity;  ///< Whether gravity affects this body
-  Vector2 speed; ///< Current velocity (units/second)
-  Vector2 acc;   ///< Current acceleration (units/second²)
+  float mass;        ///< Object mass (g), 0 or INFINITY for static objects
+  float invmass;     ///< Inverse mass (1/mass), 0 for static objects
+  float damping;     ///< Velocity damping factor (0 = no damping)
+  BodyType type;     ///< Physics behavior type
+  bool gravity;      ///< Whether gravity affects this body
+  Vector2 speed;     ///< Current velocity (units/second)
+  Vector2 acc;       ///< Current acceleration (units/second²)
+  float restitution; ///< Bounciness (0 = no bounce, 1 = elastic)
+  bool ccd;          ///< Continuous collision detection for fast bodies
+  Vector2 origin;    ///< Position at the start of the step (internal)
+  bool sleeping;     ///< Whether the body is asleep (internal)
+  float idle;        ///< Seconds spent under the sleep speed (internal)
 } RigidBody;
 
 /**
@@ -300,7 +394,12 @@ typedef struct {
    type,                                                                       \
    (type == BodyDynamic) ? true : false,                                       \
    {0, 0},                                                                     \
-   {0, 0}}
+   {0, 0},                                                                     \
+   0,                                                                          \
+   false,                                                                      \
+   {0, 0},                                                                     \
+   false,                                                                      \
+   0}
 
 /**
  * Creates a static rigid body.
@@ -372,6 +471,18 @@ void ApplyForce(RigidBody *rb, Vector2 force);
  */
 void ApplyImpulse(RigidBody *rb, Vector2 impulse);
 
+/**
+ * Wakes up a sleeping rigid body.
+ *
+ * Sleeping bodies skip gravity, integration and narrow-phase until something
+ * touches them. ApplyForce() and ApplyImpulse() wake bodies automatically.
+ *
+ * @param rb RigidBody to wake up
+ *
+ * @see CollisionWorld for sleeping settings
+ */
+void WakeBody(RigidBody *rb);
+
 /**
  * Applies velocity damping to a rigid body.
  *
@@ -379,10 +490,241 @@ void ApplyImpulse(RigidBody *rb, Vector2 impulse);
  * Automatically called by the physics system.
  *
  * @param rb RigidBody to apply damping to
+ * @param dt Elapsed time in seconds
  *
- * @note Called internally by PhysicsSystem()
+ * @note Called internally by PhysicsSystem() with EcsFixedDelta()
  */
-void ApplyDamping(RigidBody *rb);
+void ApplyDamping(RigidBody *rb, float dt);
+
+/**
+ * State hash hook for RigidBody component.
+ *
+ * Hashes every field without the padding bytes. Registered with
+ * ComponentHash().
+ *
+ * @see EcsStateHash()
+ */
+void RigidBodyHash(const void *self, Stream *out);
+
+// ########### //
+//  COLLISION  //
+// ########### //
+
+/**
+ * Persistent contact between two colliders.
+ *
+ * Contacts are cached by entity pair across frames. The pair is always
+ * ordered (a < b) and the collision normal points from a to b.
+ */
+typedef struct {
+  Entity a;            ///< First entity of the pair (lowest ID)
+  Entity b;            ///< Second entity of the pair (highest ID)
+  Collision collision; ///< Collision details from a to b
+  float impulse;       ///< Accumulated normal impulse (warm starting)
+  float bounce;        ///< Restitution target speed (internal)
+  Entity ia;           ///< Index of a in CollisionWorld.bodies (internal)
+  Entity ib;           ///< Index of b in CollisionWorld.bodies (internal)
+  uint32_t ga;         ///< Generation of a (see EntityData, internal)
+  uint32_t gb;         ///< Generation of b (see EntityData, internal)
+} Contact;
+
+/**
+ * Collider gathered by the CollisionSystem for the current frame.
+ *
+ * Component pointers are resolved once per frame and stay valid until the
+ * events are dispatched.
+ */
+typedef struct {
+  Entity entity;         ///< Collider entity
+  Layer layer;           ///< Entity layer
+  bool listener;         ///< Whether the entity has a CollisionListener
+  Transform2 *transform; ///< Entity transform
+  Collider *collider;    ///< Entity collider
+  RigidBody *body;       ///< Entity rigid body, NULL if it has none
+  Entity island;         ///< Index of the island root body (internal)
+  bool awake;            ///< Island has an awake body, for roots (internal)
+  float idle;            ///< Island minimum idle time, for roots (internal)
+  size_t slot;           ///< Island contact cursor, for roots (internal)
+} CollisionBody;
+
+/**
+ * Collider bounds on the sweep axis, sorted by the broad-phase.
+ */
+typedef struct {
+  float min;    ///< Left edge of the bounding box
+  float max;    ///< Right edge of the bounding box
+  Entity body;  ///< Index of the body in CollisionWorld.bodies
+  size_t first; ///< First pair of the body in CollisionWorld.pairs
+} CollisionSweep;
+
+/**
+ * Candidate pair found by the broad-phase.
+ */
+typedef struct {
+  Entity ia;   ///< Index of the first body (lowest ID)
+  Entity ib;   ///< Index of the second body (highest ID)
+  bool hit;    ///< Colliders overlap (narrow-phase result)
+  bool pushed; ///< New or deeper solid contact (narrow-phase result)
+} CollisionPair;
+
+/**
+ * Group of dynamic bodies connected by solid contacts.
+ *
+ * Islands are solved independently and fall asleep as a whole.
+ */
+typedef struct {
+  Entity root;  ///< Index of the root body in CollisionWorld.bodies
+  size_t first; ///< First contact of the island in CollisionWorld.order
+  size_t count; ///< Number of solid contacts of the island
+} Island;
+
+/**
+ * World-wide collision state.
+ *
+ * Holds the persistent contact cache used by the CollisionSystem. The
+ * contacts of the current step are compared with the ones of the previous
+ * step to emit enter, stay and exit events and to warm start the solver.
+ * Both lists are sorted by entity pair.
+ *
+ * Solid contacts are solved with sequential impulses, island by island.
+ * Islands whose bodies stay under sleepSpeed for sleepTime seconds fall
+ * asleep: they skip gravity, integration and narrow-phase until they are
+ * touched or receive a force.
+ *
+ * Each step runs as a pipeline: sweep and prune broad-phase, narrow-phase over
+ * batches of pairs, then islands solved independently. With threads > 1 the
+ * stages are split between worker threads; batches don't depend on the
+ * thread count, so the results are the same with any number of threads.
+ *
+ * Events are written to a contiguous buffer during the narrow-phase and
+ * dispatched to the listeners once every pair has been processed, so
+ * handlers may safely create or destroy entities and read the whole buffer.
+ *
+ * EcsWorld() attaches it to the main camera entity.
+ *
+ * @see WorldCollisions()
+ * @see CollisionSystem()
+ */
+typedef struct {
+  uint8_t iterations;      ///< Velocity solver iterations per step
+  float sleepSpeed;        ///< Speed under which bodies rest (0 = no sleeping)
+  float sleepTime;         ///< Seconds at rest before an island falls asleep
+  uint8_t threads;         ///< Threads running the pipeline (0 or 1 = serial)
+  JobPool *jobs;           ///< Worker threads (internal)
+  uint8_t pooled;          ///< threads when jobs was created (internal)
+  double cpu;              ///< CPU time of the workers (seconds, total)
+  Contact *contacts;       ///< Contacts of the current frame
+  size_t count;            ///< Number of contacts of the current frame
+  size_t alloc;            ///< Allocated contacts (internal)
+  Contact *cache;          ///< Contacts of the previous frame (internal)
+  size_t cached;           ///< Number of contacts of the previous frame
+  size_t cache_alloc;      ///< Allocated cached contacts (internal)
+  CollisionEvent *events;  ///< Events of the current frame sorted by listener
+  size_t event_count;      ///< Number of events of the current frame
+  size_t event_alloc;      ///< Allocated events (internal)
+  CollisionBody *bodies;   ///< Colliders gathered for the current frame
+  size_t body_count;       ///< Number of gathered colliders
+  size_t body_alloc;       ///< Allocated colliders (internal)
+  CollisionSweep *sweep;   ///< Colliders sorted on the x axis (internal)
+  size_t sweep_alloc;      ///< Allocated sweep entries (internal)
+  CollisionPair *pairs;    ///< Broad-phase pairs of the current step
+  size_t pair_count;       ///< Number of broad-phase pairs
+  size_t pair_alloc;       ///< Allocated pairs (internal)
+  Island *islands;         ///< Islands of the current step
+  size_t island_count;     ///< Number of islands
+  size_t island_alloc;     ///< Allocated islands (internal)
+  size_t *order;           ///< Solid contacts sorted by island (internal)
+  size_t order_alloc;      ///< Allocated contact indices (internal)
+} CollisionWorld;
+
+/**
+ * Creates a collision world with solver and sleeping settings.
+ *
+ * @param it Velocity solver iterations per step
+ * @param speed Speed under which bodies are at rest (0 disables sleeping)
+ * @param time Seconds at rest before an island falls asleep
+ * @return CollisionWorld initializer
+ */
+#define CollisionWorldCreate(it, speed, time)                                  \
+  {.iterations = it, .sleepSpeed = speed, .sleepTime = time}
+
+/**
+ * Creates a collision world with the default settings.
+ *
+ * 8 solver iterations, bodies under 2 units/second fall asleep after half a
+ * second.
+ *
+ * Example: AddComponent(world, e, CollisionWorld, CollisionWorldDefault);
+ */
+#define CollisionWorldDefault CollisionWorldCreate(8, 2.f, .5f)
+
+/**
+ * Finds the contact between two entities in the current frame.
+ *
+ * The order of the entities doesn't matter.
+ *
+ * @param cw Collision world to search in
+ * @param a First entity
+ * @param b Second entity
+ * @return Contact between a and b, or NULL if they aren't touching
+ */
+Contact *CollisionWorldFind(CollisionWorld *cw, Entity a, Entity b);
+
+/**
+ * Gets the events received by an entity on the current frame.
+ *
+ * Events are sorted by listener, so the ones of a single entity are
+ * contiguous. Only entities with a CollisionListener receive events.
+ *
+ * @param cw Collision world to search in
+ * @param self Entity receiving the events
+ * @param count Output number of events
+ * @return First event of the entity, or NULL if it has none
+ *
+ * Example:
+ * ```
+ * size_t count;
+ * CollisionEvent *events = CollisionWorldEvents(cw, player, &count);
+ * for (size_t i = 0; i < count; i++)
+ *   TakeDamage(ecs, player, events[i].other);
+ * ```
+ */
+CollisionEvent *CollisionWorldEvents(CollisionWorld *cw, Entity self,
+                                     size_t *count);
+
+/**
+ * Destructor for CollisionWorld component.
+ *
+ * Frees the contact cache and stops the worker threads when the component is
+ * removed or the registry is freed. Registered with ComponentDynamic().
+ *
+ * @param self Pointer to CollisionWorld instance
+ */
+void CollisionWorldDestructor(void *self);
+
+/**
+ * Snapshot hooks for CollisionWorld component.
+ *
+ * Only the settings and the contacts of the last step are kept: the
+ * contacts warm start the next step and emit its exit events. Every other
+ * buffer, and the worker threads, are created again on the next step.
+ * Registered with ComponentSerialize().
+ *
+ * @see EcsSnapshot()
+ */
+void CollisionWorldSave(const void *self, Stream *out);
+void CollisionWorldLoad(void *self, Stream *in);
+
+/**
+ * Rollback hook for CollisionWorld component.
+ *
+ * Restores the settings and the contacts into the buffers already allocated,
+ * and keeps the worker threads, so rolling back allocates nothing once warm.
+ * Registered with ComponentRollback().
+ *
+ * @see EcsLoadFrame()
+ */
+void CollisionWorldRestore(void *self, const void *saved, Stream *in);
 
 // ######## //
 //  SPRITE  //
@@ -401,6 +743,302 @@ typedef struct {
   Color tint;    ///< Color tint for rendering
 } Sprite;
 
+/**
+ * Render order of an entity inside its layer.
+ *
+ * The RenderOrderSystem turns it into the entity sort key: z alone, or the y
+ * position plus z when ysort is set, so entities lower on the screen are
+ * drawn over the ones behind them.
+ */
+typedef struct {
+  float z;    ///< Order inside the layer (offset of the y position on ysort)
+  bool ysort; ///< Sort by y position
+} RenderOrder;
+
+/**
+ * Fixed render order inside the layer.
+ *
+ * @param z Order inside the layer (higher is drawn later)
+ */
+#define RenderOrderZ(z) ((RenderOrder){z, false})
+
+/**
+ * Render order following the y position of the entity.
+ *
+ * @param offset Offset added to the y position (e.g. to sort by the feet)
+ */
+#define RenderOrderY(offset) ((RenderOrder){offset, true})
+
+// ############# //
+//  RENDER VIEW  //
+// ############# //
+
+/**
+ * Sprite bounds tracked by a RenderView.
+ */
+typedef struct {
+  Rectangle bounds; ///< World-space bounding box of the sprite
+  int32_t x0;       ///< First grid column covered by the bounds
+  int32_t y0;       ///< First grid row covered by the bounds
+  int32_t x1;       ///< Last grid column covered by the bounds
+  int32_t y1;       ///< Last grid row covered by the bounds
+  uint32_t stamp;   ///< Last frame the sprite was queried (internal)
+  bool indexed;     ///< Whether the sprite is in the grid (internal)
+} RenderProxy;
+
+/**
+ * Cell of the RenderView spatial hash grid.
+ */
+typedef struct {
+  int32_t x;        ///< Cell column
+  int32_t y;        ///< Cell row
+  bool used;        ///< Whether the slot holds a cell (internal)
+  Entity *entities; ///< Sprites overlapping the cell
+  uint32_t count;   ///< Number of sprites in the cell
+  uint32_t alloc;   ///< Allocated sprites (internal)
+} RenderCell;
+
+/**
+ * Camera visibility state for the render phases.
+ *
+ * Sprite bounds are kept in a spatial hash grid: a sprite only moves between
+ * cells when its bounds cross a cell border. Every frame the CullingSystem
+ * computes the world rectangle seen by the camera, queries the grid and
+ * culls the sprites outside of it, so EcsOnRender systems only run on
+ * visible entities.
+ *
+ * Sprites covering too many cells (backgrounds) are kept in a single list
+ * tested every frame.
+ *
+ * EcsWorld() attaches it to the main camera entity.
+ *
+ * @see WorldView()
+ * @see CullingSystem()
+ */
+typedef struct {
+  float cell;            ///< Grid cell size (world units)
+  Vector2 screen;        ///< View size in pixels (0 = window size)
+  Rectangle view;        ///< Camera world rectangle of the current frame
+  size_t visible;        ///< Sprites inside the view on the current frame
+  size_t culled;         ///< Sprites outside the view on the current frame
+  Entity *list;          ///< Visible sprites of the current frame, sorted
+  size_t list_alloc;     ///< Allocated visible sprites (internal)
+  RenderProxy *proxies;  ///< Sprite bounds indexed by entity (internal)
+  size_t proxy_alloc;    ///< Allocated proxies (internal)
+  size_t indexed;        ///< Number of sprites in the grid
+  RenderCell *cells;     ///< Hash grid (open addressing, internal)
+  size_t cell_count;     ///< Cells in use (internal)
+  size_t cell_alloc;     ///< Grid slots, a power of two (internal)
+  RenderCell large;      ///< Sprites covering too many cells (internal)
+  uint32_t frame;        ///< Frame counter (internal)
+  Color background;      ///< Clear color of the frame
+} RenderView;
+
+/**
+ * Creates a render view with the given grid cell size.
+ *
+ * @param size Grid cell size in world units (around a screen tile)
+ * @return RenderView initializer
+ */
+#define RenderViewCreate(size) {.cell = size, .background = {23, 28, 29, 255}}
+
+/**
+ * Creates a render view with 256 units grid cells.
+ *
+ * Example: AddComponent(world, camera, RenderView, RenderViewDefault);
+ */
+#define RenderViewDefault RenderViewCreate(256.f)
+
+/**
+ * Destructor for RenderView component.
+ *
+ * Frees the spatial grid and the visible list. Registered with
+ * ComponentDynamic().
+ *
+ * @param self Pointer to RenderView instance
+ */
+void RenderViewDestructor(void *self);
+
+/**
+ * Snapshot load hook for RenderView component.
+ *
+ * Keeps the settings and empties the grid: sprites are indexed again on the
+ * next frame. Registered with ComponentSerialize() without save hook.
+ *
+ * @param self Pointer to the restored RenderView
+ * @param in Snapshot stream (unused)
+ */
+void RenderViewLoad(void *self, Stream *in);
+
+// ############## //
+//  RENDER QUEUE  //
+// ############## //
+
+/**
+ * Recorded texture draw.
+ *
+ * Holds the arguments of a DrawTexturePro() call, plus the ordering keys.
+ */
+typedef struct {
+  Texture tex;      ///< Texture to draw
+  Rectangle src;    ///< Source rectangle within the texture
+  Rectangle dest;   ///< Destination rectangle in world space
+  Vector2 origin;   ///< Rotation origin, relative to dest
+  float rotation;   ///< Rotation in degrees
+  Color tint;       ///< Color tint
+  uint8_t layer;    ///< Entity layer (drawn in layer order)
+  uint32_t sort;    ///< Order inside the layer (24 bits, lowest first)
+} DrawCommand;
+
+/**
+ * Sort key of a draw command (internal).
+ */
+typedef struct {
+  uint32_t key;   ///< Layer and sort packed from high to low bits
+  uint32_t index; ///< Index of the command in the queue
+} RenderSortItem;
+
+/**
+ * Contiguous buffer of draw commands.
+ *
+ * Render systems push commands instead of drawing. RenderQueueFlush() sorts
+ * them by layer and sort key with a stable radix sort, then draws them:
+ * consecutive commands using the same texture form a single batch. Commands
+ * with equal keys keep their submission order, and textures never reorder
+ * them, so overlapping sprites are drawn as without the queue.
+ *
+ * A headless queue only records: flushing sorts the commands and counts the
+ * batches without drawing, which allows testing and benchmarking the render
+ * phase without a window.
+ *
+ * EcsWorld() attaches it to the main camera entity and flushes it after the
+ * EcsOnRender phase.
+ *
+ * @see WorldQueue()
+ * @see SpriteBatchSystem()
+ */
+typedef struct {
+  bool headless;            ///< Record only, never draw
+  DrawCommand *commands;    ///< Commands (sorted after a flush)
+  size_t count;             ///< Commands pushed since the last flush
+  size_t alloc;             ///< Allocated commands (internal)
+  DrawCommand *sorted;      ///< Sorting buffer (internal)
+  RenderSortItem *items;    ///< Sort keys (internal)
+  RenderSortItem *scratch;  ///< Sort keys buffer (internal)
+  size_t sort_alloc;        ///< Allocated sorting buffers (internal)
+  size_t drawn;             ///< Commands of the last flush
+  size_t batches;           ///< Texture batches of the last flush
+} RenderQueue;
+
+/**
+ * Creates a render queue.
+ *
+ * @param record true to only record the commands (no window needed)
+ * @return RenderQueue initializer
+ */
+#define RenderQueueCreate(record) {.headless = record}
+
+/**
+ * Creates a render queue drawing with raylib.
+ *
+ * Example: AddComponent(world, camera, RenderQueue, RenderQueueDefault);
+ */
+#define RenderQueueDefault RenderQueueCreate(false)
+
+/**
+ * Adds a draw command to a render queue.
+ *
+ * @param queue Queue to record into
+ * @param command Command to record
+ */
+void RenderQueuePush(RenderQueue *queue, DrawCommand command);
+
+/**
+ * Sorts and draws the recorded commands, then empties the queue.
+ *
+ * The sorted commands of the flush stay readable in queue->commands, from 0
+ * to queue->drawn, until the next push. Must be called inside BeginMode2D()
+ * unless the queue is headless.
+ *
+ * @param queue Queue to flush
+ *
+ * Example:
+ * ```
+ * EcsRunSystems(ecs, EcsOnRender);
+ * RenderQueueFlush(queue);
+ * printf("%zu sprites in %zu batches\n", queue->drawn, queue->batches);
+ * ```
+ */
+void RenderQueueFlush(RenderQueue *queue);
+
+/**
+ * Destructor for RenderQueue component.
+ *
+ * Frees the command and sorting buffers. Registered with ComponentDynamic().
+ *
+ * @param self Pointer to RenderQueue instance
+ */
+void RenderQueueDestructor(void *self);
+
+/**
+ * Snapshot load hook for RenderQueue component.
+ *
+ * Keeps the headless flag and empties the buffers. Registered with
+ * ComponentSerialize() without save hook.
+ *
+ * @param self Pointer to the restored RenderQueue
+ * @param in Snapshot stream (unused)
+ */
+void RenderQueueLoad(void *self, Stream *in);
+
+// ############# //
+//  FIXED CLOCK  //
+// ############# //
+
+/**
+ * Fixed timestep state of a world.
+ *
+ * EcsStep() adds the frame time to the accumulator and runs one fixed update
+ * per EcsFixedDelta() of accumulated time. After a hitch, at most max_steps
+ * fixed updates run in one step and the rest of the time is dropped, so a
+ * slow frame never makes the next one slower.
+ *
+ * alpha is the fraction of a fixed update left in the accumulator: render
+ * systems blend the last two fixed states with it (see Interpolation).
+ *
+ * The CPU time of each step is measured on the thread running it, plus the
+ * workers of its CollisionWorld, so the cost of a world stays comparable
+ * when many are stepped in parallel.
+ *
+ * EcsWorld() attaches it to the main camera entity.
+ *
+ * @see WorldClock()
+ */
+typedef struct {
+  float accumulator;   ///< Time not simulated yet (seconds)
+  float alpha;         ///< Interpolation factor of the last step, in [0, 1)
+  uint16_t max_steps;  ///< Fixed updates per step (0 = no cap)
+  uint16_t steps;      ///< Fixed updates run by the last step
+  float dropped;       ///< Time dropped by the cap (seconds, total)
+  double cpu;          ///< CPU time spent by the last step (seconds)
+  double cpu_total;    ///< CPU time spent by every step (seconds)
+} FixedClock;
+
+/**
+ * Creates a fixed clock with a cap of max fixed updates per step.
+ *
+ * @param max Fixed updates per step (0 = no cap)
+ * @return FixedClock initializer
+ */
+#define FixedClockCreate(max) {.max_steps = max}
+
+/**
+ * Creates a fixed clock running up to 8 fixed updates per step.
+ *
+ * Example: AddComponent(world, camera, FixedClock, FixedClockDefault);
+ */
+#define FixedClockDefault FixedClockCreate(8)
+
 // ########### //
 //  BEHAVIOUR  //
 // ########### //
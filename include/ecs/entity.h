@@ -33,6 +33,17 @@ typedef uint16_t EcsID;
  */
 typedef EcsID Entity;
 
+/**
+ * An interned entity tag.
+ *
+ * Tag strings are copied and hashed once by the registry. Comparing two tag
+ * ids is the same as comparing the strings.
+ *
+ * @see TagIntern() to get the id of a tag
+ * @see EntityHasTagID() to compare tags without strings
+ */
+typedef EcsID TagID;
+
 /**
  * Signatures are bitmasks that refer to sets of components.
  *
@@ -49,22 +60,45 @@ typedef EcsID Entity;
  */
 typedef uint64_t Signature;
 
+/**
+ * A layer handle, returned by AddLayer().
+ *
+ * Layers are indices in creation order: they give the render order and a
+ * row of the collision matrix. Names are only resolved when the layer is
+ * created or looked up with LayerFind().
+ *
+ * Supports up to 64 layers.
+ */
+typedef uint8_t Layer;
+
+/**
+ * Maximum number of layers of a registry, one per bit of a Signature.
+ */
+#define MaxLayers 64
+
+/**
+ * Returned by the layer api when a layer doesn't exist.
+ */
+#define InvalidLayer ((Layer) - 1)
+
 /**
  * Entity metadata and state management component.
  *
- * Provides entity tagging, activity/visibility control, rendering layer, and
- * component signature information for entity management and system filtering.
+ * Provides entity tagging, rendering layer, and component signature
+ * information for entity management and system filtering. Alive, active,
+ * visible and culled states are kept by the registry in packed bitsets.
  *
  * @see EntitySetActive() to control activity state
  * @see EntitySetVisible() to control visibility state
+ * @see EntitySetCulled() to skip rendering for a frame
  * @see EntityFindByTag() to find entities by tag
  */
 typedef struct {
   Signature signature; ///< Component signature bitmask for system filtering
-  bool active;         ///< Whether entity participates in Update systems
-  bool visible;        ///< Whether entity participates in Render systems
-  char *tag;           ///< Entity identifier string for lookup and debugging
-  uint8_t layer;       ///< Layer used for rendering and collisions
+  const char *tag;     ///< Entity identifier string (interned, read only)
+  TagID tag_id;        ///< Interned tag, InvalidID without tag
+  Layer layer;         ///< Layer used for rendering and collisions
+  uint32_t generation; ///< Times the entity ID was freed (tells reuses apart)
 } EntityData;
 
 #endif
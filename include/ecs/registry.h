@@ -24,6 +24,9 @@
 
 #include <ecs/entity.h>
 
+#include <mem/stream.h>
+#include <mem/trace.h>
+
 #include <stddef.h>
 
 /**
@@ -69,12 +72,28 @@ typedef EcsID Component;
  */
 typedef void (*Script)(ECS *, Entity);
 
+/**
+ * Component filter of a system.
+ *
+ * Entities match when they have every component of `with` and none of
+ * `without`. Components in `optional` don't filter: they document what the
+ * system reads when present (GetComponent() returns NULL otherwise).
+ *
+ * @see SystemQuery() to create systems with a query
+ * @see EcsQueryMatches() to test entities by hand
+ */
+typedef struct {
+  Signature with;     ///< Required components
+  Signature without;  ///< Excluded components
+  Signature optional; ///< Components read when present (not filtered)
+} EcsQuery;
+
 /**
  * A system processes all entities that contain the desired components.
  *
- * Systems combine a script function with a component signature filter.
- * During execution, the system iterates over all entities and calls the
- * script function only for entities matching the signature.
+ * Systems combine a script function with a component query. The registry
+ * keeps the set of matching entities up to date when components are added
+ * or removed, so during execution the system only visits matching entities.
  *
  * Systems are organized into layers (Update, FixedUpdate, Render, etc.)
  * and can target entities based on their active/visible state.
@@ -83,8 +102,10 @@ typedef void (*Script)(ECS *, Entity);
  * @see EcsPhase for system execution phases
  */
 typedef struct {
-  Script run;     ///< Function to execute for matching entities
-  Signature mask; ///< Component signature filter
+  Script run;       ///< Function to execute for matching entities
+  EcsQuery query;   ///< Component filter
+  uint64_t *match;  ///< Bitset of the matching entities (internal)
+  const char *name; ///< Script name, NULL if unnamed (see EcsProfile)
 } System;
 
 /**
@@ -122,17 +143,23 @@ void EcsFree(ECS *ecs);
  * Returns a unique entity ID. Entity IDs are recycled after destruction
  * for memory efficiency. New entities start with no components.
  *
+ * The tag is copied and interned, see EntityFindByTag().
+ *
  * @param ecs Registry to create entity in
+ * @param tag Entity tag (nullable)
  * @return New entity ID
  *
  * @see EcsEntityFree() to destroy entities
  * @see AddComponent() to add components to entities
  */
-Entity EcsEntity(ECS *ecs, char *tag);
+Entity EcsEntity(ECS *ecs, const char *tag);
 
 /**
  * Checks if an entity is still alive (not destroyed).
  *
+ * Alive, active, visible and culled states are packed bitsets in the
+ * registry: every state check is a single bit test.
+ *
  * @param ecs Registry containing the entity
  * @param e Entity ID to check
  * @return true if entity is alive, false if destroyed
@@ -161,6 +188,25 @@ void EcsEntityFree(ECS *ecs, Entity e);
  */
 Entity EcsEntityCount(ECS *ecs);
 
+/**
+ * Gets the upper bound of the entity IDs in use.
+ *
+ * Every entity ever created has an ID lower than this value, so it can be
+ * used to iterate the whole registry. Destroyed entities inside the range
+ * have an empty signature and are never active.
+ *
+ * @param ecs Registry to query
+ * @return First entity ID that was never created
+ *
+ * Example:
+ * ```
+ * for (Entity e = 0; e < EcsEntityEnd(ecs); e++)
+ *   if (EcsHasComponents(ecs, e, mask) && EntityIsActive(ecs, e))
+ *     ...
+ * ```
+ */
+Entity EcsEntityEnd(ECS *ecs);
+
 /**
  * Executes a script function on every alive entity.
  *
@@ -196,10 +242,11 @@ void EcsForEachEntity(ECS *ecs, Script script);
 EntityData *EcsEntityData(ECS *ecs, Entity e);
 
 /**
- * Finds the first entity with the specified tag.
+ * Finds an entity with the specified tag.
  *
- * Performs linear search through all entities with EntityData components.
- * Returns an invalid entity ID if no matching entity is found.
+ * Tags are kept in a hash index: the lookup doesn't depend on the number of
+ * entities. When several entities share the tag, returns the oldest one
+ * unless some of them were destroyed or retagged.
  *
  * @param ecs Registry to search in
  * @param tag Tag string to search for
@@ -210,8 +257,31 @@ EntityData *EcsEntityData(ECS *ecs, Entity e);
  * if(EntityFindByTag(ecs, "Player2") == InvalidID)
  *    printf("Not Found\n");
  * ```
+ *
+ * @see EntityFindAllByTag() to get every entity with the tag
  */
-Entity EntityFindByTag(ECS *ecs, char *tag);
+Entity EntityFindByTag(ECS *ecs, const char *tag);
+
+/**
+ * Finds every entity with the specified tag.
+ *
+ * The returned array belongs to the registry, in no particular order. It is
+ * valid until an entity gets or loses this tag.
+ *
+ * @param ecs Registry to search in
+ * @param tag Tag string to search for
+ * @param count Output number of entities
+ * @return Entities with matching tag, or NULL if none
+ *
+ * Example:
+ * ```
+ * Entity count;
+ * const Entity *spawners = EntityFindAllByTag(ecs, "Spawner", &count);
+ * for (Entity i = 0; i < count; i++)
+ *   Spawn(ecs, spawners[i]);
+ * ```
+ */
+const Entity *EntityFindAllByTag(ECS *ecs, const char *tag, Entity *count);
 
 /**
  * Checks if an entity has a specific tag.
@@ -220,8 +290,69 @@ Entity EntityFindByTag(ECS *ecs, char *tag);
  * @param e Entity to check
  * @param tag Tag string to compare
  * @return true if entity has matching tag, false otherwise
+ *
+ * @see EntityHasTagID() to skip the string lookup
+ */
+bool EntityHasTag(ECS *ecs, Entity e, const char *tag);
+
+/**
+ * Checks if an entity has a specific interned tag.
+ *
+ * A single integer compare: scripts checking the same tag every frame intern
+ * it once with TagIntern().
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to check
+ * @param tag Interned tag
+ * @return true if entity has the tag, false otherwise
+ */
+bool EntityHasTagID(ECS *ecs, Entity e, TagID tag);
+
+/**
+ * Changes the tag of an entity.
+ *
+ * Tags must be changed through this function to keep the tag index up to
+ * date: EntityData::tag is read only.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to tag
+ * @param tag New tag (nullable)
+ */
+void EntitySetTag(ECS *ecs, Entity e, const char *tag);
+
+/**
+ * Gets the interned id of a tag, adding it to the registry if needed.
+ *
+ * @param ecs Registry owning the tags
+ * @param tag Tag string
+ * @return Interned tag, or InvalidID if tag is NULL
+ *
+ * Example:
+ * ```
+ * TagID enemy = TagIntern(ecs, "Enemy");
+ * if (EntityHasTagID(ecs, event->other, enemy))
+ *   TakeDamage(ecs, event->self);
+ * ```
+ */
+TagID TagIntern(ECS *ecs, const char *tag);
+
+/**
+ * Gets the interned id of a tag without adding it.
+ *
+ * @param ecs Registry owning the tags
+ * @param tag Tag string
+ * @return Interned tag, or InvalidID if no entity ever had this tag
+ */
+TagID TagFind(ECS *ecs, const char *tag);
+
+/**
+ * Gets the string of an interned tag.
+ *
+ * @param ecs Registry owning the tags
+ * @param tag Interned tag
+ * @return Tag string owned by the registry, or NULL if tag is invalid
  */
-bool EntityHasTag(ECS *ecs, Entity e, char *tag);
+const char *TagName(ECS *ecs, TagID tag);
 
 /**
  * Sets whether an entity is active for system processing.
@@ -271,6 +402,31 @@ void EntitySetVisible(ECS *ecs, Entity e, bool visible);
  */
 bool EntityIsVisible(ECS *ecs, Entity e);
 
+/**
+ * Sets whether an entity is culled for the current frame.
+ *
+ * Culled entities are skipped by EcsOnRender systems (not Gui ones). The
+ * flag is written every frame by the CullingSystem for entities with a
+ * sprite, depending on whether they are inside the camera view.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to modify
+ * @param culled true to skip rendering, false to render
+ *
+ * @see EntityIsCulled() to check state
+ * @see EntitySetVisible() for persistent render control
+ */
+void EntitySetCulled(ECS *ecs, Entity e, bool culled);
+
+/**
+ * Checks if an entity is culled for the current frame.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to check
+ * @return true if culled, false otherwise
+ */
+bool EntityIsCulled(ECS *ecs, Entity e);
+
 // ########### //
 //  COMPONENT  //
 // ########### //
@@ -304,6 +460,90 @@ bool EntityIsVisible(ECS *ecs, Entity e);
  */
 #define ComponentDynamic(ecs, C, dtor) EcsComponent(ecs, #C, sizeof(C), dtor)
 
+/**
+ * Registers a tag component: a component without data.
+ *
+ * Tags only exist in the entity signature, to filter systems (e.g. Enemy,
+ * Frozen, Sleeping). C is just a name: no type has to be declared. Not to
+ * be confused with the entity tag string (EntityFindByTag()).
+ *
+ * @param ecs Registry containing the component
+ * @param C Tag name
+ *
+ * Example:
+ * ```
+ * ComponentTag(world, Frozen);
+ * AddTag(world, enemy, Frozen);
+ * SystemQuery(world, EnemyAI, EcsOnUpdate,
+ *             .with = EcsSignature(world, Enemy),
+ *             .without = EcsSignature(world, Frozen));
+ * ```
+ */
+#define ComponentTag(ecs, C) EcsComponent(ecs, #C, 0, NULL)
+
+/**
+ * Adds a tag component to an entity.
+ *
+ * @param ecs Registry containing the entity
+ * @param entity Entity to tag
+ * @param C Tag name
+ */
+#define AddTag(ecs, entity, C)                                                 \
+  EcsAddComponent(ecs, entity, EcsComponentID(ecs, #C), NULL)
+
+/**
+ * Removes a tag component from an entity.
+ *
+ * @param ecs Registry containing the entity
+ * @param entity Entity to untag
+ * @param C Tag name
+ */
+#define RemoveTag(ecs, entity, C)                                              \
+  EcsRemoveComponent(ecs, entity, EcsComponentID(ecs, #C))
+
+/**
+ * Checks if an entity has a tag component.
+ *
+ * @param ecs Registry containing the entity
+ * @param entity Entity to check
+ * @param C Tag name
+ * @return true if the entity has the tag
+ */
+#define HasTag(ecs, entity, C)                                                 \
+  EcsHasComponent(ecs, entity, EcsComponentID(ecs, #C))
+
+/**
+ * Adds a tag component to many entities at once.
+ *
+ * Only the signatures and the systems filtering by the tag are updated, so
+ * thousands of entities can be flipped every frame.
+ *
+ * @param ecs Registry containing the entities
+ * @param entities Entities to tag
+ * @param count Number of entities
+ * @param C Tag name
+ *
+ * Example:
+ * ```
+ * Entity count;
+ * const Entity *enemies = EntityFindAllByTag(world, "Goblin", &count);
+ * AddTagBulk(world, enemies, count, Frozen);
+ * ```
+ */
+#define AddTagBulk(ecs, entities, count, C)                                    \
+  EcsSetTagBulk(ecs, entities, count, EcsComponentID(ecs, #C), true)
+
+/**
+ * Removes a tag component from many entities at once.
+ *
+ * @param ecs Registry containing the entities
+ * @param entities Entities to untag
+ * @param count Number of entities
+ * @param C Tag name
+ */
+#define RemoveTagBulk(ecs, entities, count, C)                                 \
+  EcsSetTagBulk(ecs, entities, count, EcsComponentID(ecs, #C), false)
+
 /**
  * Adds a component to an entity with initialization values.
  *
@@ -339,6 +579,35 @@ bool EntityIsVisible(ECS *ecs, Entity e);
 #define GetComponent(ecs, entity, C)                                           \
   (C *)EcsGetComponent(ecs, entity, EcsComponentID(ecs, #C))
 
+/**
+ * Retrieves a component from an entity to modify it.
+ *
+ * Same as GetComponent(), but the component is marked as changed on the
+ * current tick, so the next EcsDelta() sends it. Writes through
+ * GetComponent() aren't tracked.
+ *
+ * @param ecs Registry containing the entity
+ * @param entity Entity to get component from
+ * @param C Component type name
+ * @return Typed pointer to component data, or NULL if not found
+ *
+ * Example: GetComponentMut(world, player, Transform2)->position = spawn;
+ */
+#define GetComponentMut(ecs, entity, C)                                        \
+  ((C *)EcsGetComponentMut(ecs, entity, EcsComponentID(ecs, #C)))
+
+/**
+ * Marks a component of an entity as changed on the current tick.
+ *
+ * For components written through pointers kept from GetComponent().
+ *
+ * @param ecs Registry containing the entity
+ * @param entity Entity owning the component
+ * @param C Component type name
+ */
+#define MarkChanged(ecs, entity, C)                                            \
+  EcsMarkChanged(ecs, entity, EcsComponentID(ecs, #C))
+
 /**
  * Removes a component from an entity.
  *
@@ -370,13 +639,17 @@ bool EntityIsVisible(ECS *ecs, Entity e);
  * metadata and allocates storage for all entities with a destructor function
  * for cleanup.
  *
+ * The name is interned by the registry. Registering a name twice returns
+ * the ID of the first registration.
+ *
  * @param ecs Registry to register component in
  * @param name Component type name for identification
  * @param size Size of component structure in bytes
  * @param dtor A destructor function
  * @return Component ID: EcsID
  */
-Component EcsComponent(ECS *ecs, char *name, size_t size, void (*dtor)(void *));
+Component EcsComponent(ECS *ecs, const char *name, size_t size,
+                       void (*dtor)(void *));
 
 /**
  * Adds component data to an entity using raw data pointer.
@@ -403,6 +676,21 @@ void EcsAddComponent(ECS *ecs, Entity e, Component id, void *data);
  */
 void EcsRemoveComponent(ECS *ecs, Entity e, Component id);
 
+/**
+ * Sets or clears a tag component on a list of entities.
+ *
+ * Low-level function used by the AddTagBulk() and RemoveTagBulk() macros.
+ * The component must be a tag (registered with size 0).
+ *
+ * @param ecs Registry containing the entities
+ * @param entities Entities to update
+ * @param count Number of entities
+ * @param id Tag component ID
+ * @param set true to add the tag, false to remove it
+ */
+void EcsSetTagBulk(ECS *ecs, const Entity *entities, size_t count,
+                   Component id, bool set);
+
 /**
  * Gets component data from an entity using component ID.
  *
@@ -416,6 +704,30 @@ void EcsRemoveComponent(ECS *ecs, Entity e, Component id);
  */
 void *EcsGetComponent(ECS *ecs, Entity e, Component id);
 
+/**
+ * Gets component data from an entity and marks it as changed.
+ *
+ * Low-level function used by the GetComponentMut() macro.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to get component from
+ * @param id Component ID to retrieve
+ * @return Pointer to component data, or NULL if not found
+ */
+void *EcsGetComponentMut(ECS *ecs, Entity e, Component id);
+
+/**
+ * Marks a component of an entity as changed using its ID.
+ *
+ * Low-level function used by the MarkChanged() macro. Does nothing if the
+ * entity doesn't have the component.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity owning the component
+ * @param id Component ID
+ */
+void EcsMarkChanged(ECS *ecs, Entity e, Component id);
+
 /**
  * @brief Checks if an entity has the specified component.
  *
@@ -444,14 +756,14 @@ bool EcsHasComponents(ECS *ecs, Entity e, Signature mask);
 /**
  * Finds component ID by component name.
  *
- * Performs binary search through registered components. Returns an invalid id
- * if not found. Be carefull before using it.
+ * Resolves the name through the registry string table: one hash and one
+ * compare. Returns an invalid id if not found. Be carefull before using it.
  *
  * @param ecs Registry to search
  * @param name Component type name to find
  * @return Component ID, or invalid ID if not found.
  */
-Component EcsComponentID(ECS *ecs, char *name);
+Component EcsComponentID(ECS *ecs, const char *name);
 
 // ######### //
 //  SYSTEMS  //
@@ -475,6 +787,27 @@ Component EcsComponentID(ECS *ecs, char *name);
  */
 #define FIXED_DELTATIME 1.f / FIXED_UPDATES
 
+/**
+ * Sets the fixed timestep of a registry.
+ *
+ * FixedUpdate systems read it with EcsFixedDelta(), so the fixed rate can be
+ * changed at runtime and differ between worlds. Defaults to FIXED_DELTATIME.
+ *
+ * @param ecs Registry to configure
+ * @param dt Fixed timestep in seconds (ignored if not positive)
+ *
+ * Example: EcsSetFixedDelta(world, 1.f / 120); // 120 fixed updates/s
+ */
+void EcsSetFixedDelta(ECS *ecs, float dt);
+
+/**
+ * Gets the fixed timestep of a registry.
+ *
+ * @param ecs Registry to query
+ * @return Fixed timestep in seconds
+ */
+float EcsFixedDelta(ECS *ecs);
+
 /**
  * System execution phases define when systems run in the game loop.
  *
@@ -483,24 +816,115 @@ Component EcsComponentID(ECS *ecs, char *name);
  * 2. Update - Runs every frame for gameplay logic
  * 3. LateUpdate - Runs after Update for post-processing
  * 4. FixedUpdate - Runs at fixed interval for physics
- * 5. Render - Runs for drawing operations
- * 6. Gui - Runs for UI overlay rendering
+ * 5. PreRender - Runs once per frame before drawing (culling)
+ * 6. Render - Runs for drawing operations
+ * 7. Gui - Runs for UI overlay rendering
  */
 typedef enum {
   EcsOnStart = 0,   ///< Initialization systems (run once)
   EcsOnUpdate,      ///< Frame-dependent gameplay logic
   EcsOnLateUpdate,  ///< Post-update processing
   EcsOnFixedUpdate, ///< Fixed timestep physics/consistent logic
+  EcsOnPreRender,   ///< Per-frame preparation of the render phases
   EcsOnRender,      ///< Rendering operations
   EcsOnGui,         ///< UI and overlay rendering
   EcsTotalPhases    ///< Total number of system phases
 } EcsPhase;
 
+/// @cond INTERNAL
+// Applies m to each argument (up to 64), separated by commas.
+#define EcsMap1(m, a) m(a)
+#define EcsMap2(m, a, ...) m(a), EcsMap1(m, __VA_ARGS__)
+#define EcsMap3(m, a, ...) m(a), EcsMap2(m, __VA_ARGS__)
+#define EcsMap4(m, a, ...) m(a), EcsMap3(m, __VA_ARGS__)
+#define EcsMap5(m, a, ...) m(a), EcsMap4(m, __VA_ARGS__)
+#define EcsMap6(m, a, ...) m(a), EcsMap5(m, __VA_ARGS__)
+#define EcsMap7(m, a, ...) m(a), EcsMap6(m, __VA_ARGS__)
+#define EcsMap8(m, a, ...) m(a), EcsMap7(m, __VA_ARGS__)
+#define EcsMap9(m, a, ...) m(a), EcsMap8(m, __VA_ARGS__)
+#define EcsMap10(m, a, ...) m(a), EcsMap9(m, __VA_ARGS__)
+#define EcsMap11(m, a, ...) m(a), EcsMap10(m, __VA_ARGS__)
+#define EcsMap12(m, a, ...) m(a), EcsMap11(m, __VA_ARGS__)
+#define EcsMap13(m, a, ...) m(a), EcsMap12(m, __VA_ARGS__)
+#define EcsMap14(m, a, ...) m(a), EcsMap13(m, __VA_ARGS__)
+#define EcsMap15(m, a, ...) m(a), EcsMap14(m, __VA_ARGS__)
+#define EcsMap16(m, a, ...) m(a), EcsMap15(m, __VA_ARGS__)
+#define EcsMap17(m, a, ...) m(a), EcsMap16(m, __VA_ARGS__)
+#define EcsMap18(m, a, ...) m(a), EcsMap17(m, __VA_ARGS__)
+#define EcsMap19(m, a, ...) m(a), EcsMap18(m, __VA_ARGS__)
+#define EcsMap20(m, a, ...) m(a), EcsMap19(m, __VA_ARGS__)
+#define EcsMap21(m, a, ...) m(a), EcsMap20(m, __VA_ARGS__)
+#define EcsMap22(m, a, ...) m(a), EcsMap21(m, __VA_ARGS__)
+#define EcsMap23(m, a, ...) m(a), EcsMap22(m, __VA_ARGS__)
+#define EcsMap24(m, a, ...) m(a), EcsMap23(m, __VA_ARGS__)
+#define EcsMap25(m, a, ...) m(a), EcsMap24(m, __VA_ARGS__)
+#define EcsMap26(m, a, ...) m(a), EcsMap25(m, __VA_ARGS__)
+#define EcsMap27(m, a, ...) m(a), EcsMap26(m, __VA_ARGS__)
+#define EcsMap28(m, a, ...) m(a), EcsMap27(m, __VA_ARGS__)
+#define EcsMap29(m, a, ...) m(a), EcsMap28(m, __VA_ARGS__)
+#define EcsMap30(m, a, ...) m(a), EcsMap29(m, __VA_ARGS__)
+#define EcsMap31(m, a, ...) m(a), EcsMap30(m, __VA_ARGS__)
+#define EcsMap32(m, a, ...) m(a), EcsMap31(m, __VA_ARGS__)
+#define EcsMap33(m, a, ...) m(a), EcsMap32(m, __VA_ARGS__)
+#define EcsMap34(m, a, ...) m(a), EcsMap33(m, __VA_ARGS__)
+#define EcsMap35(m, a, ...) m(a), EcsMap34(m, __VA_ARGS__)
+#define EcsMap36(m, a, ...) m(a), EcsMap35(m, __VA_ARGS__)
+#define EcsMap37(m, a, ...) m(a), EcsMap36(m, __VA_ARGS__)
+#define EcsMap38(m, a, ...) m(a), EcsMap37(m, __VA_ARGS__)
+#define EcsMap39(m, a, ...) m(a), EcsMap38(m, __VA_ARGS__)
+#define EcsMap40(m, a, ...) m(a), EcsMap39(m, __VA_ARGS__)
+#define EcsMap41(m, a, ...) m(a), EcsMap40(m, __VA_ARGS__)
+#define EcsMap42(m, a, ...) m(a), EcsMap41(m, __VA_ARGS__)
+#define EcsMap43(m, a, ...) m(a), EcsMap42(m, __VA_ARGS__)
+#define EcsMap44(m, a, ...) m(a), EcsMap43(m, __VA_ARGS__)
+#define EcsMap45(m, a, ...) m(a), EcsMap44(m, __VA_ARGS__)
+#define EcsMap46(m, a, ...) m(a), EcsMap45(m, __VA_ARGS__)
+#define EcsMap47(m, a, ...) m(a), EcsMap46(m, __VA_ARGS__)
+#define EcsMap48(m, a, ...) m(a), EcsMap47(m, __VA_ARGS__)
+#define EcsMap49(m, a, ...) m(a), EcsMap48(m, __VA_ARGS__)
+#define EcsMap50(m, a, ...) m(a), EcsMap49(m, __VA_ARGS__)
+#define EcsMap51(m, a, ...) m(a), EcsMap50(m, __VA_ARGS__)
+#define EcsMap52(m, a, ...) m(a), EcsMap51(m, __VA_ARGS__)
+#define EcsMap53(m, a, ...) m(a), EcsMap52(m, __VA_ARGS__)
+#define EcsMap54(m, a, ...) m(a), EcsMap53(m, __VA_ARGS__)
+#define EcsMap55(m, a, ...) m(a), EcsMap54(m, __VA_ARGS__)
+#define EcsMap56(m, a, ...) m(a), EcsMap55(m, __VA_ARGS__)
+#define EcsMap57(m, a, ...) m(a), EcsMap56(m, __VA_ARGS__)
+#define EcsMap58(m, a, ...) m(a), EcsMap57(m, __VA_ARGS__)
+#define EcsMap59(m, a, ...) m(a), EcsMap58(m, __VA_ARGS__)
+#define EcsMap60(m, a, ...) m(a), EcsMap59(m, __VA_ARGS__)
+#define EcsMap61(m, a, ...) m(a), EcsMap60(m, __VA_ARGS__)
+#define EcsMap62(m, a, ...) m(a), EcsMap61(m, __VA_ARGS__)
+#define EcsMap63(m, a, ...) m(a), EcsMap62(m, __VA_ARGS__)
+#define EcsMap64(m, a, ...) m(a), EcsMap63(m, __VA_ARGS__)
+#define EcsMapSelect(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13,   \
+  _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28,   \
+  _29, _30, _31, _32, _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43,   \
+  _44, _45, _46, _47, _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58,   \
+  _59, _60, _61, _62, _63, _64, m, ...) m
+#define EcsMap(m, ...) EcsMapSelect(__VA_ARGS__, EcsMap64, EcsMap63,           \
+  EcsMap62, EcsMap61, EcsMap60, EcsMap59, EcsMap58, EcsMap57, EcsMap56,        \
+  EcsMap55, EcsMap54, EcsMap53, EcsMap52, EcsMap51, EcsMap50, EcsMap49,        \
+  EcsMap48, EcsMap47, EcsMap46, EcsMap45, EcsMap44, EcsMap43, EcsMap42,        \
+  EcsMap41, EcsMap40, EcsMap39, EcsMap38, EcsMap37, EcsMap36, EcsMap35,        \
+  EcsMap34, EcsMap33, EcsMap32, EcsMap31, EcsMap30, EcsMap29, EcsMap28,        \
+  EcsMap27, EcsMap26, EcsMap25, EcsMap24, EcsMap23, EcsMap22, EcsMap21,        \
+  EcsMap20, EcsMap19, EcsMap18, EcsMap17, EcsMap16, EcsMap15, EcsMap14,        \
+  EcsMap13, EcsMap12, EcsMap11, EcsMap10, EcsMap9, EcsMap8, EcsMap7, EcsMap6,  \
+  EcsMap5, EcsMap4, EcsMap3, EcsMap2, EcsMap1, _)(m, __VA_ARGS__)
+#define EcsMapString(a) #a
+/// @endcond
+
 /**
  * Creates a component signature from component type names.
  *
  * Macro that converts a comma-separated list of component names into
- * a signature bitmask for system filtering.
+ * a signature bitmask for system filtering. Each name is turned into its own
+ * string literal at compile time: nothing is parsed or copied at runtime,
+ * and any number of components (up to the 64 of a registry) can be listed.
+ *
+ * Signatures don't change once the components are registered: compute them
+ * once (systems do it when registered) instead of on every entity.
  *
  * @param ecs Registry containing registered components
  * @param ... Component type names (comma-separated, no quotes)
@@ -508,19 +932,27 @@ typedef enum {
  *
  * Example: EcsSignature(ecs, Position, Speed, Health)
  */
-#define EcsSignature(ecs, ...) EcsSignatureImpl(ecs, #__VA_ARGS__)
+#define EcsSignature(ecs, ...)                                                 \
+  EcsSignatureImpl(ecs,                                                        \
+                   (const char *const[]){EcsMap(EcsMapString, __VA_ARGS__)},  \
+                   sizeof((const char *const[]){EcsMap(EcsMapString,          \
+                                                       __VA_ARGS__)}) /       \
+                       sizeof(const char *))
 
 /**
- * Implements signature creation from string.
+ * Implements signature creation from component names.
  *
- * Low-level function that parses component names from a string and
- * builds the corresponding signature bitmask.
+ * Low-level function that resolves each name through the registry string
+ * table and builds the corresponding signature bitmask. Only reads the
+ * registry: safe to call from several threads while no component is being
+ * registered.
  *
  * @param ecs Registry containing registered components
- * @param str String containing comma-separated component names
+ * @param names Component type names
+ * @param count Number of names
  * @return Signature bitmask
  */
-Signature EcsSignatureImpl(ECS *ecs, const char *str);
+Signature EcsSignatureImpl(ECS *ecs, const char *const *names, size_t count);
 
 /**
  * Creates a system that processes entities with specific components.
@@ -529,8 +961,6 @@ Signature EcsSignatureImpl(ECS *ecs, const char *str);
  * assigns it to a specific execution phase. The system will only run
  * on entities that have ALL specified components.
  *
- * @note The maximum component number per system is 8.
- *
  * @param ecs Registry to add system to
  * @param script Function to execute for matching entities
  * @param layer Execution layer (EcsOnUpdate, etc.)
@@ -539,10 +969,11 @@ Signature EcsSignatureImpl(ECS *ecs, const char *str);
  * Example: System(ecs, MovePlayer, EcsOnUpdate, Position, Velocity);
  *
  * @see EcsRunSystems()
- * @see EcsAddSystem() to manually add a system with more than 8 components.
+ * @see EcsAddSystem() to manually add a system with a custom signature.
  */
 #define System(ecs, script, layer, ...)                                        \
-  EcsAddSystem(ecs, script, layer, EcsSignature(ecs, __VA_ARGS__))
+  EcsAddSystemNamed(ecs, script, #script, layer,                               \
+                    (EcsQuery){EcsSignature(ecs, __VA_ARGS__), 0, 0})
 
 /**
  * Creates a global system that processes all entities regardless of components.
@@ -556,7 +987,31 @@ Signature EcsSignatureImpl(ECS *ecs, const char *str);
  *
  * Example: SystemGlobal(ecs, DebugDraw, EcsOnRender);
  */
-#define SystemGlobal(ecs, script, layer) EcsAddSystem(ecs, script, layer, 0);
+#define SystemGlobal(ecs, script, layer)                                       \
+  EcsAddSystemNamed(ecs, script, #script, layer, (EcsQuery){0, 0, 0});
+
+/**
+ * Creates a system with a full component query.
+ *
+ * Entities with an excluded component are filtered out when the component
+ * is added, not rejected in the script on every run.
+ *
+ * @param ecs Registry to add system to
+ * @param script Function to execute for matching entities
+ * @param layer Execution layer (EcsOnUpdate, etc.)
+ * @param ... EcsQuery fields (designated initializers)
+ *
+ * Example:
+ * ```
+ * SystemQuery(ecs, GravitySystem, EcsOnFixedUpdate,
+ *             .with = EcsSignature(ecs, RigidBody),
+ *             .without = EcsSignature(ecs, Sleeping));
+ * ```
+ *
+ * @see EcsQuery
+ */
+#define SystemQuery(ecs, script, layer, ...)                                   \
+  EcsAddSystemNamed(ecs, script, #script, layer, (EcsQuery){__VA_ARGS__})
 
 /**
  * Adds a system to the registry with explicit parameters.
@@ -571,14 +1026,61 @@ Signature EcsSignatureImpl(ECS *ecs, const char *str);
  */
 void EcsAddSystem(ECS *ecs, Script s, EcsPhase phase, Signature mask);
 
+/**
+ * Adds a system with a full component query.
+ *
+ * Low-level function used by SystemQuery().
+ *
+ * @param ecs Registry to add system to
+ * @param s Script function to execute
+ * @param phase Execution layer
+ * @param query Component filter
+ */
+void EcsAddSystemQuery(ECS *ecs, Script s, EcsPhase phase, EcsQuery query);
+
+/**
+ * Adds a named system with a full component query.
+ *
+ * Low-level function used by the System() macros, which name the system
+ * after its script. The name shows in the profiles (see EcsProfile).
+ *
+ * @param ecs Registry to add system to
+ * @param s Script function to execute
+ * @param name Name of the system (not copied: a string literal)
+ * @param phase Execution layer
+ * @param query Component filter
+ */
+void EcsAddSystemNamed(ECS *ecs, Script s, const char *name, EcsPhase phase,
+                       EcsQuery query);
+
+/**
+ * Gets the number of systems of a phase.
+ *
+ * @param ecs Registry containing the systems
+ * @param phase Execution phase
+ * @return Number of systems, in execution order
+ */
+EcsID EcsSystemCount(ECS *ecs, EcsPhase phase);
+
+/**
+ * Checks if an entity matches a query.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to check
+ * @param query Component filter
+ * @return true if the entity has every `with` and no `without` component
+ */
+bool EcsQueryMatches(ECS *ecs, Entity e, EcsQuery query);
+
 /**
  * Runs all systems in a specific execution phase.
  *
  * Iterates through all systems in the phase and executes them on entities
  * that match their component signatures and current active/visible state.
  *
- * Update systems (Start, Update, LateUpdate, FixedUpdate) only run on
- * active entities. Render systems (Render, Gui) only run on visible entities.
+ * Update systems (Start, Update, LateUpdate, FixedUpdate, PreRender) only
+ * run on active entities. Render systems (Render, Gui) only run on visible
+ * entities, and Render systems skip culled entities.
  *
  * @param ecs Registry to run systems in
  * @param ly Execution layer to run
@@ -596,32 +1098,115 @@ void EcsRunSystems(ECS *ecs, EcsPhase phase);
  *
  * Creates a new layer with collision enabled for all other layers by default.
  * Layers are managed by the registry and used for both collision filtering
- * and render ordering. Each layer can interact with up to 64 other layers
- * through bitmask filtering.
+ * and render ordering. A registry holds up to MaxLayers (64) layers, and
+ * each layer can interact with the others through a row of the collision
+ * bit matrix.
+ *
+ * The name is copied and hashed once: the returned handle is used by every
+ * other layer function without string compares. Adding an existing name
+ * returns the handle of that layer.
  *
  * @param ecs Registry to add the layer to
  * @param name Layer name
+ * @return Handle of the layer, or InvalidLayer if MaxLayers was reached
  *
  * @see EntitySetLayer() to assign entities to this layer
  * @see LayerDisable() to disable specific collisions
+ *
+ * Example:
+ * ```
+ * Layer ghosts = AddLayer(ecs, "ghosts");
+ * LayerDisableAll(ecs, ghosts);
+ * ```
+ */
+Layer AddLayer(ECS *ecs, const char *name);
+
+/**
+ * @brief Finds a layer by name.
+ *
+ * @param ecs Registry containing the layers
+ * @param name Layer name
+ * @return Handle of the layer, or InvalidLayer if it doesn't exist
  */
-void AddLayer(ECS *ecs, char *name);
+Layer LayerFind(ECS *ecs, const char *name);
+
+/**
+ * @brief Gets the name of a layer.
+ *
+ * @param ecs Registry containing the layer
+ * @param layer Layer handle
+ * @return Name copy owned by the registry
+ */
+const char *LayerName(ECS *ecs, Layer layer);
 
 /**
  * @brief Assigns an entity to a specific layer.
  *
  * Sets the entity's layer which determines collision filtering and
- * render ordering.
+ * render ordering. Moving an entity between layers is O(1).
  *
  * @param ecs Registry containing the entity and layers
  * @param e Entity to assign to layer
- * @param layer Name of the layer to assign entity to
+ * @param layer Layer returned by AddLayer()
  *
  * @see AddLayer() to create layers
  * @see LayerEnable() to enable collisions
  * @see LayerIncludes() for collision checking
  */
-void EntitySetLayer(ECS *ecs, Entity e, char *layer);
+void EntitySetLayer(ECS *ecs, Entity e, Layer layer);
+
+/**
+ * @brief Sets the render order of an entity inside its layer.
+ *
+ * Render systems process the entities of a layer from the lowest to the
+ * highest key. Entities with the same key keep their insertion order, which
+ * doesn't change when other entities are removed. The key is kept when the
+ * entity changes of layer.
+ *
+ * The layer is sorted again before the next render phase, with an insertion
+ * sort: cheap when only a few keys change between frames.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to sort
+ * @param key Render order (0 by default)
+ *
+ * @see RenderOrderSystem() to sort by z and y position
+ */
+void EntitySetSortKey(ECS *ecs, Entity e, float key);
+
+/**
+ * @brief Gets the render order of an entity inside its layer.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to query
+ * @return Sort key of the entity
+ */
+float EntityGetSortKey(ECS *ecs, Entity e);
+
+/**
+ * @brief Gets the position of the sort key of an entity inside its layer.
+ *
+ * Entities with the same key share the same rank. Updated when the layer is
+ * sorted, before each render phase.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to query
+ * @return Rank of the entity sort key (0 for the lowest key)
+ */
+uint16_t EntitySortRank(ECS *ecs, Entity e);
+
+/**
+ * @brief Gets the position of an entity in the render order of its layer.
+ *
+ * Unlike EntitySortRank(), entities with the same key get different
+ * positions, in the order render systems process them. Positions only grow
+ * along the layer, but aren't contiguous while removed entries are pending.
+ *
+ * @param ecs Registry containing the entity
+ * @param e Entity to query
+ * @return Position in the layer, InvalidID if the entity isn't listed
+ */
+EcsID EntitySortIndex(ECS *ecs, Entity e);
 
 /**
  * @brief Enables collision between two layers.
@@ -629,13 +1214,13 @@ void EntitySetLayer(ECS *ecs, Entity e, char *layer);
  * Sets up bidirectional collision filtering between the specified layers.
  *
  * @param ecs Registry containing the layers
- * @param layer1 Name of the first layer
- * @param layer2 Name of the second layer
+ * @param layer1 First layer
+ * @param layer2 Second layer
  *
  * @see LayerDisable() to disable collisions
  * @see LayerIncludes() to check if collisions are enabled
  */
-void LayerEnable(ECS *ecs, char *layer1, char *layer2);
+void LayerEnable(ECS *ecs, Layer layer1, Layer layer2);
 
 /**
  * @brief Disables collision between two layers.
@@ -643,43 +1228,589 @@ void LayerEnable(ECS *ecs, char *layer1, char *layer2);
  * Removes bidirectional collision filtering between the specified layers.
  *
  * @param ecs Registry containing the layers
- * @param layer1 Name of the first layer
- * @param layer2 Name of the second layer
+ * @param layer1 First layer
+ * @param layer2 Second layer
  *
  * @see LayerEnable() to enable collisions
  * @see LayerDisableAll() to disable all collisions for a layer
  */
-void LayerDisable(ECS *ecs, char *layer1, char *layer2);
+void LayerDisable(ECS *ecs, Layer layer1, Layer layer2);
 
 /**
  * @brief Disables all collisions for a specific layer.
  *
  * Removes collision filtering between the specified layer and all other
- * layers.
+ * layers, in both directions.
  *
  * @param ecs Registry containing the layer
- * @param layer Name of the layer to disable all collisions for
+ * @param layer Layer to disable all collisions for
  *
  * @see LayerEnable() to re-enable specific collisions
  * @see LayerDisable() to disable specific layer pairs
  */
-void LayerDisableAll(ECS *ecs, char *layer);
+void LayerDisableAll(ECS *ecs, Layer layer);
 
 /**
  * @brief Checks if two layers can collide with each other.
  *
- * Determine if entities on the specified layers can collide. This is the fast
- * path for collision checking using pre-resolved layer IDs, typically used in
- * collision systems.
+ * Determine if entities on the specified layers can collide. Without layers
+ * every entity is in layer 0, which collides with itself.
  *
  * @param ecs Registry containing the layers
- * @param layer1 ID of the first layer (0-255)
- * @param layer2 ID of the second layer (0-255)
+ * @param layer1 First layer
+ * @param layer2 Second layer
  * @return true if the layers can collide, false otherwise
  *
- * @see LayerIndex() to convert layer names to IDs
+ * @see LayerMatrix() to check many pairs
  * @see EntitySetLayer() to assign entities to layers
  */
-bool LayerIncludes(ECS *ecs, uint8_t layer1, uint8_t layer2);
+bool LayerIncludes(ECS *ecs, Layer layer1, Layer layer2);
+
+/**
+ * @brief Gets the collision bit matrix of the registry.
+ *
+ * Row i has bit j set when layer i collides with layer j. The matrix lives
+ * as long as the registry, so collision systems read it once per step and
+ * test pairs with LayerMatrixIncludes().
+ *
+ * @param ecs Registry containing the layers
+ * @return MaxLayers rows of the collision matrix
+ */
+const Signature *LayerMatrix(ECS *ecs);
+
+/**
+ * Checks a pair of layers in a collision matrix.
+ *
+ * @param matrix Matrix returned by LayerMatrix()
+ * @param layer1 First layer
+ * @param layer2 Second layer
+ */
+#define LayerMatrixIncludes(matrix, layer1, layer2)                            \
+  ((((matrix)[layer1] >> (layer2)) & 1) != 0)
+
+// ########## //
+//  SNAPSHOT  //
+// ########## //
+
+/**
+ * Version of the snapshot format written by EcsSnapshot().
+ */
+#define SnapshotVersion 2
+
+/**
+ * Writes the data owned by a component (behind its pointers) to a snapshot.
+ *
+ * The component bytes themselves are always copied: the hook only appends
+ * what they point to.
+ *
+ * @param self Component to save
+ * @param out Snapshot stream
+ */
+typedef void (*ComponentSave)(const void *self, Stream *out);
+
+/**
+ * Rebuilds the data owned by a restored component.
+ *
+ * self holds the bytes copied from the snapshot: its pointers refer to the
+ * saved registry and must be replaced, never freed.
+ *
+ * @param self Restored component
+ * @param in Data appended by the save hook, in entity order
+ */
+typedef void (*ComponentLoad)(void *self, Stream *in);
+
+/**
+ * Registers the serialization hooks of a component.
+ *
+ * Components without destructor are plain data and copied as they are.
+ * Components with a destructor own memory, so they are only saved once their
+ * hooks are registered; either hook may be NULL when nothing is owned on
+ * that side (e.g. caches rebuilt from scratch on load).
+ *
+ * @param ecs Registry containing the component
+ * @param C Component type name
+ * @param save Save hook (nullable)
+ * @param load Load hook (nullable)
+ *
+ * Example: ComponentSerialize(world, Collider, ColliderSave, ColliderLoad);
+ */
+#define ComponentSerialize(ecs, C, save, load)                                 \
+  EcsComponentSerialize(ecs, EcsComponentID(ecs, #C), save, load)
+
+/**
+ * Registers the serialization hooks of a component using its ID.
+ *
+ * Low-level function used by the ComponentSerialize() macro.
+ *
+ * @param ecs Registry containing the component
+ * @param id Component ID
+ * @param save Save hook (nullable)
+ * @param load Load hook (nullable)
+ */
+void EcsComponentSerialize(ECS *ecs, Component id, ComponentSave save,
+                           ComponentLoad load);
+
+/**
+ * Writes the whole state of a registry to a stream.
+ *
+ * The snapshot holds the entities (signatures, tags, layers, render order,
+ * states and free list), the layers with their collision matrix, and every
+ * component column as a single raw block followed by the data of its save
+ * hook. Components are identified by name, so the registry restoring it
+ * only needs to register the same components, in any order.
+ *
+ * Function pointers (Behaviour scripts) are copied as they are: they are
+ * only valid in the same executable.
+ *
+ * @param ecs Registry to save
+ * @param out Stream receiving the snapshot (appended)
+ * @return true on success
+ *
+ * Example:
+ * ```
+ * Stream save = {0};
+ * if (EcsSnapshot(world, &save))
+ *   StreamSave(&save, "save.bin");
+ * StreamFree(&save);
+ * ```
+ */
+bool EcsSnapshot(ECS *ecs, Stream *out);
+
+/**
+ * Replaces the entities of a registry with a snapshot.
+ *
+ * Every entity is freed, then the snapshot is loaded with one copy per
+ * column. Missing layers are created. Components unknown to the registry
+ * are skipped, and a component whose size changed fails the restore.
+ * Systems are kept and matched again with the restored entities.
+ *
+ * The snapshot is validated and every table and column it fills is grown
+ * before anything is freed: a truncated or incompatible snapshot, or an
+ * allocation failure, leaves the registry untouched (the grown tables keep
+ * their larger capacity).
+ *
+ * @param ecs Registry to restore
+ * @param in Stream positioned at the snapshot
+ * @return true on success
+ */
+bool EcsRestore(ECS *ecs, Stream *in);
+
+/**
+ * Bakes the registry into a scene file.
+ *
+ * A scene is a snapshot saved as it is: its columns are laid out like the
+ * registry stores them, padded so they can be read in place.
+ *
+ * @param ecs Registry to save
+ * @param path Scene file path
+ * @return true on success
+ */
+bool EcsSceneSave(ECS *ecs, const char *path);
+
+/**
+ * Loads a scene file baked with EcsSceneSave().
+ *
+ * The file is mapped instead of read (StreamMap()): entity data is read in
+ * place, and each component column is copied with a single memcpy, so only
+ * the pages of the file actually used are loaded. Pointer fields are fixed
+ * by the load hooks registered with ComponentSerialize().
+ *
+ * @param ecs Registry receiving the scene (see EcsRestore())
+ * @param path Scene file path
+ * @return true on success
+ */
+bool EcsSceneLoad(ECS *ecs, const char *path);
+
+// ####### //
+//  DELTA  //
+// ####### //
+
+/**
+ * Version of the delta format written by EcsDelta().
+ */
+#define DeltaVersion 1
+
+/**
+ * Gets the tick stamped on the changes made now.
+ *
+ * Every structural change (entity created or freed, component added or
+ * removed) and every write through GetComponentMut() or MarkChanged() is
+ * stamped with the current tick, per entity and per block of 64 entities.
+ * EcsDelta() starts a new tick.
+ *
+ * @param ecs Registry to query
+ * @return Current tick (starts at 1)
+ */
+uint32_t EcsChangeTick(ECS *ecs);
+
+/**
+ * Registers the delta encoding of a component.
+ *
+ * Without hooks, the component bytes are sent as they are. Hooks can send
+ * fewer bytes, e.g. with StreamWriteQuantized() and StreamWriteVarint().
+ * The decode hook receives the current value of the component (zeroed if the
+ * entity doesn't have it yet).
+ *
+ * @param ecs Registry containing the component
+ * @param C Component type name
+ * @param encode Encode hook
+ * @param decode Decode hook
+ *
+ * Example: ComponentDelta(world, Transform2, TransformEncode, TransformDecode);
+ */
+#define ComponentDelta(ecs, C, encode, decode)                                 \
+  EcsComponentDelta(ecs, EcsComponentID(ecs, #C), encode, decode)
+
+/**
+ * Registers the delta encoding of a component using its ID.
+ *
+ * Low-level function used by the ComponentDelta() macro.
+ *
+ * @param ecs Registry containing the component
+ * @param id Component ID
+ * @param encode Encode hook
+ * @param decode Decode hook
+ */
+void EcsComponentDelta(ECS *ecs, Component id, ComponentSave encode,
+                       ComponentLoad decode);
+
+/**
+ * Writes the changes made after a tick, then starts a new tick.
+ *
+ * Only the entities changed after since are written: their signature when
+ * it changed, and the components written after since. Blocks of 64 entities
+ * without changes are skipped at once, so the cost follows the number of
+ * changes rather than the number of entities.
+ *
+ * Components with a destructor own memory and are never sent: neither their
+ * data nor their presence. Entity tag names, layers and states aren't sent
+ * either.
+ *
+ * Keep one tick per client: the changes it hasn't acknowledged are the ones
+ * after the tick of the last delta it received.
+ *
+ * @param ecs Registry to read
+ * @param since Last tick known by the receiver (0 for everything)
+ * @param out Stream receiving the delta (appended)
+ * @return Tick covered by the delta, to pass as since for the next one
+ *
+ * Example:
+ * ```
+ * Stream packet = {0};
+ * client->acked = EcsDelta(world, client->acked, &packet);
+ * ```
+ */
+uint32_t EcsDelta(ECS *ecs, uint32_t since, Stream *out);
+
+/**
+ * Applies a delta written by EcsDelta() to a replica of the registry.
+ *
+ * The replica must register the same components, in the same order, and
+ * keep the same entity IDs (e.g. restored from a snapshot of the source).
+ * Entities are created or freed to match the source. The delta is checked
+ * before anything is changed: a truncated or mismatched delta leaves the
+ * registry untouched.
+ *
+ * @param ecs Replica registry
+ * @param in Stream positioned at the delta
+ * @return true on success
+ */
+bool EcsApplyDelta(ECS *ecs, Stream *in);
+
+// ########## //
+//  ROLLBACK  //
+// ########## //
+
+/**
+ * Ring buffer of recent world states, for rollback.
+ *
+ * Each state is a copy of the registry tables and component columns, kept in
+ * memory by the registry that saved it: unlike a snapshot, it can't be
+ * written to disk or restored in another registry. The buffers are reused
+ * by later saves, so saving every frame allocates nothing once the ring is
+ * warm.
+ *
+ * Created with RollbackCreate() and freed with RollbackFree().
+ */
+typedef struct {
+  Stream *frames;    ///< Saved states, one per slot
+  uint32_t *ids;     ///< Frame number of each state
+  uint32_t capacity; ///< Number of slots
+  uint32_t count;    ///< Number of saved states
+  uint32_t head;     ///< Slot written by the next save
+} Rollback;
+
+/**
+ * Creates a rollback ring.
+ *
+ * @param capacity Number of states kept (the oldest one is overwritten)
+ * @return Created ring (capacity 0 if the allocation failed)
+ */
+Rollback RollbackCreate(uint32_t capacity);
+
+/**
+ * Frees a rollback ring and its saved states.
+ *
+ * @param rb Ring to free
+ */
+void RollbackFree(Rollback *rb);
+
+/**
+ * Saves the state of the registry as a frame of a rollback ring.
+ *
+ * Component columns are copied in bulk. Components with a destructor are
+ * saved with their serialization hooks (see ComponentSerialize()), and are
+ * dropped on load if they have none, as in EcsSnapshot().
+ *
+ * @param ecs Registry to save
+ * @param rb Ring receiving the state
+ * @param frame Frame number, to find the state with EcsLoadFrame()
+ * @return true on success
+ */
+bool EcsSaveFrame(ECS *ecs, Rollback *rb, uint32_t frame);
+
+/**
+ * Restores the registry to a frame saved by EcsSaveFrame().
+ *
+ * Entities, components, tags, layers and states are restored as saved, and
+ * the newer frames are dropped from the ring: they belong to the timeline
+ * being replaced. Everything restored is marked changed, as in EcsRestore().
+ *
+ * The frame is checked, and the tables grown, before anything is replaced:
+ * on failure the registry and the ring are left untouched.
+ *
+ * @param ecs Registry that saved the frame
+ * @param rb Ring holding the frame
+ * @param frame Frame number
+ * @return true on success, false if the frame isn't in the ring or can't be
+ * loaded
+ *
+ * Example:
+ * ```
+ * // a late input arrived for frame f: replay from there
+ * EcsLoadFrame(world, &rb, f);
+ * ApplyInput(world, input);
+ * for (uint32_t k = f; k < now; k++) {
+ *   EcsSaveFrame(world, &rb, k);
+ *   EcsStepFixed(world, 1);
+ * }
+ * ```
+ */
+bool EcsLoadFrame(ECS *ecs, Rollback *rb, uint32_t frame);
+
+/**
+ * Restores a component in place from a rollback frame.
+ *
+ * Called instead of the destructor and the load hook when the entity owns
+ * the component both before and after EcsLoadFrame(), so the memory it owns
+ * (buffers, threads) can be reused.
+ *
+ * @param self Current component, still owning its memory
+ * @param saved Bytes saved with the frame, unaligned (copy them with memcpy)
+ *              and holding stale pointers
+ * @param in Data appended by the save hook for this component
+ */
+typedef void (*ComponentRestore)(void *self, const void *saved, Stream *in);
+
+/**
+ * Registers the rollback hook of a component.
+ *
+ * Without it, a component with a destructor is destroyed and rebuilt by its
+ * load hook on every EcsLoadFrame(), as in EcsRestore().
+ *
+ * @param ecs Registry containing the component
+ * @param C Component type name
+ * @param restore Rollback hook
+ *
+ * Example: ComponentRollback(world, CollisionWorld, CollisionWorldRestore);
+ */
+#define ComponentRollback(ecs, C, restore)                                     \
+  EcsComponentRollback(ecs, EcsComponentID(ecs, #C), restore)
+
+/**
+ * Registers the rollback hook of a component using its ID.
+ *
+ * Low-level function used by the ComponentRollback() macro.
+ *
+ * @param ecs Registry containing the component
+ * @param id Component ID
+ * @param restore Rollback hook (nullable)
+ */
+void EcsComponentRollback(ECS *ecs, Component id, ComponentRestore restore);
+
+// ###### //
+//  HASH  //
+// ###### //
+
+/**
+ * Registers the state hash hook of a component.
+ *
+ * The hook writes the fields that define the state of the component, e.g.
+ * to skip padding bytes, pointers or caches. Without a hook, the component
+ * bytes are hashed as they are, and components with a destructor only count
+ * by their presence.
+ *
+ * @param ecs Registry containing the component
+ * @param C Component type name
+ * @param hash Hash hook, writing the hashed fields to the stream
+ *
+ * Example: ComponentHash(world, RigidBody, RigidBodyHash);
+ */
+#define ComponentHash(ecs, C, hash)                                            \
+  EcsComponentHash(ecs, EcsComponentID(ecs, #C), hash)
+
+/**
+ * Registers the state hash hook of a component using its ID.
+ *
+ * Low-level function used by the ComponentHash() macro.
+ *
+ * @param ecs Registry containing the component
+ * @param id Component ID
+ * @param hash Hash hook
+ */
+void EcsComponentHash(ECS *ecs, Component id, ComponentSave hash);
+
+/**
+ * Hashes the state of the registry.
+ *
+ * Covers the entity IDs, which entities are alive, which of the given
+ * components they have, and the component values. Two registries that ran
+ * the same steps from the same state have the same hash; comparing hashes
+ * every tick finds the first tick where a lockstep peer or a replay
+ * diverged.
+ *
+ * @param ecs Registry to hash
+ * @param components Components to hash (see EcsSignature())
+ * @return 64-bit FNV-1a hash
+ */
+uint64_t EcsStateHash(ECS *ecs, Signature components);
+
+// ######### //
+//  PROFILE  //
+// ######### //
+
+/**
+ * Number of frames aggregated by the profiles.
+ */
+#define ProfileWindow 120
+
+/**
+ * Time and work of a system, or of a whole phase, over the last
+ * ProfileWindow frames.
+ *
+ * Recorded by EcsRunSystems() when gearecs is compiled with GEARECS_PROFILE
+ * (the GEARECS_PROFILE CMake option). Otherwise nothing is recorded and
+ * every profile is zero: the instrumentation is compiled out.
+ */
+typedef struct {
+  const char *name;  ///< System name, or phase name
+  uint32_t frames;   ///< Frames in the window
+  uint32_t calls;    ///< Runs of the system or phase
+  double time;       ///< Wall time spent in the window (seconds)
+  double max;        ///< Wall time of the slowest frame (seconds)
+  uint64_t visited;  ///< Entities walked by the system
+  uint64_t matched;  ///< Entities the script ran on
+} EcsProfile;
+
+/**
+ * Ends the current frame of the profiles.
+ *
+ * The oldest frame leaves the window. EcsStep() calls it once per step.
+ *
+ * @param ecs Registry being profiled
+ */
+void EcsProfileFrame(ECS *ecs);
+
+/**
+ * Gets the profile of a system.
+ *
+ * For update phases, visited counts the entities matching the query and
+ * matched the active ones. For render phases, visited counts the layer
+ * entries walked and matched the visible, not culled ones.
+ *
+ * @param ecs Registry being profiled
+ * @param phase Execution phase of the system
+ * @param system Index of the system in the phase (see EcsSystemCount())
+ * @return Profile over the window
+ */
+EcsProfile EcsProfileSystem(ECS *ecs, EcsPhase phase, EcsID system);
+
+/**
+ * Gets the profile of a whole phase.
+ *
+ * The time covers every run of EcsRunSystems() for the phase, e.g. each
+ * fixed step. visited and matched add up the systems of the phase.
+ *
+ * @param ecs Registry being profiled
+ * @param phase Execution phase
+ * @return Profile over the window
+ */
+EcsProfile EcsProfilePhase(ECS *ecs, EcsPhase phase);
+
+/**
+ * Writes every profile as text or JSON.
+ *
+ * Text is a table with one line per phase followed by its systems, times in
+ * milliseconds per frame. JSON is one object with a "phases" array, each
+ * with its "systems", times in seconds over the window.
+ *
+ * @param ecs Registry being profiled
+ * @param out Stream receiving the dump (appended)
+ * @param json true for JSON, false for text
+ * @return true on success
+ *
+ * Example:
+ * ```
+ * Stream dump = {0};
+ * EcsProfileDump(world, &dump, false);
+ * printf("%.*s", (int)dump.size, (char *)dump.data);
+ * StreamFree(&dump);
+ * ```
+ */
+bool EcsProfileDump(ECS *ecs, Stream *out, bool json);
+
+// ####### //
+//  TRACE  //
+// ####### //
+
+/**
+ * Attaches a trace to a registry.
+ *
+ * While the trace records (see TraceCapture()), EcsRunSystems() adds a scope
+ * per phase (category "phase") and per system run (category "system", named
+ * after the script), and EcsStep() one per step ("Step") and per fixed step
+ * ("FixedStep"), both in category "step". A threaded CollisionWorld adds a
+ * scope per job batch run by its workers. Unlike the profiles, no compile
+ * option is needed: without a trace, or outside a capture, each scope costs
+ * a check.
+ *
+ * A trace may be shared by several registries, e.g. worlds stepped with
+ * EcsStepWorlds(): each thread gets its own track. The trace must outlive
+ * the registry, or be detached first.
+ *
+ * @param ecs Registry to trace
+ * @param trace Trace recording the scopes, or NULL to detach it
+ *
+ * Example:
+ * ```
+ * Trace *trace = TraceCreate(1 << 16);
+ * EcsSetTrace(world, trace);
+ * TraceCapture(trace, 10); // the next 10 steps
+ * for (int i = 0; i < 10; i++)
+ *   EcsStep(world, FIXED_DELTATIME);
+ *
+ * Stream json = {0};
+ * TraceDump(trace, &json); // open in ui.perfetto.dev
+ * ```
+ */
+void EcsSetTrace(ECS *ecs, Trace *trace);
+
+/**
+ * Gets the trace attached to a registry.
+ *
+ * @param ecs Registry being traced
+ * @return Attached trace, or NULL
+ */
+Trace *EcsTrace(ECS *ecs);
 
 #endif
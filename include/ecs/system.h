@@ -125,6 +125,20 @@ void HierarchyTransformSystem(ECS *ecs, Entity e);
  */
 void TransformColliderSystem(ECS *ecs, Entity e);
 
+/**
+ * System that saves transforms before each fixed update.
+ *
+ * Copies the transform into the Interpolation component, so render systems
+ * can blend the previous and current fixed states. Must run before any
+ * FixedUpdate system moving entities.
+ *
+ * Required components: Transform2, Interpolation
+ *
+ * Usage: System(ecs, InterpolationSystem, EcsOnFixedUpdate, Transform2,
+ * Interpolation)
+ */
+void InterpolationSystem(ECS *ecs, Entity e);
+
 // ########### //
 //  COLLISION  //
 // ########### //
@@ -132,17 +146,37 @@ void TransformColliderSystem(ECS *ecs, Entity e);
 /**
  * System that performs collision detection and response.
  *
- * Detects collisions between entities with colliders and generates
- * collision events for entities with CollisionListener components.
+ * Runs once per fixed step on the entity holding the CollisionWorld. Detects
+ * collisions between active entities with colliders, resolves solid ones and
+ * generates collision events for entities with CollisionListener components.
  * Handles solid vs trigger, collision layers and event handlers.
  *
- * Required components: Collider, Transform2
+ * Contacts are cached by entity pair across frames, so listeners also get
+ * OnCollisionEnter, OnCollisionStay and OnCollisionExit events. Pairs whose
+ * bounding boxes don't overlap skip the narrow-phase.
+ *
+ * Solid contacts between rigid bodies are grouped in islands and solved with
+ * warm-started sequential impulses (CollisionWorld.iterations passes). Islands
+ * that stay below CollisionWorld.sleepSpeed for CollisionWorld.sleepTime
+ * seconds are put to sleep and skipped until something touches them. When
+ * the Sleeping tag component is registered, sleeping bodies carry it from
+ * the end of the step that put them to sleep to the end of the step that
+ * woke them.
+ *
+ * Rigid bodies flagged with ccd are swept from their previous position and
+ * moved back to their time of impact before the broad-phase.
+ *
+ * Broad-phase, narrow-phase and island solving run on CollisionWorld.threads
+ * threads. Listeners are always called from the calling thread.
+ *
+ * Required components: CollisionWorld
+ * Processed entities: Collider, Transform2
  * Optional: CollisionListener (for event handling)
  * Optional: RigidBody (for newton laws based resolution)
  *
- * Usage: System(ecs, CollisionSystem, EcsOnUpdate, Transform2, Collider)
+ * Usage: System(ecs, CollisionSystem, EcsOnFixedUpdate, CollisionWorld)
  */
-void CollisionSystem(ECS *ecs, Entity e);
+void CollisionSystem(ECS *ecs, Entity world);
 
 /**
  * System that renders debug visualization for colliders.
@@ -168,8 +202,11 @@ void DebugColliderSystem(ECS *ecs, Entity e);
  * consistent physics regardless of frame rate.
  *
  * Required components: RigidBody, Transform2
+ * Excluded components: Sleeping (when registered)
  *
- * Usage: System(ecs, PhysicsSystem, EcsOnFixedUpdate, RigidBody, Transform2)
+ * Usage: SystemQuery(ecs, PhysicsSystem, EcsOnFixedUpdate,
+ *                    .with = EcsSignature(ecs, RigidBody, Transform2),
+ *                    .without = EcsSignature(ecs, Sleeping))
  */
 void PhysicsSystem(ECS *ecs, Entity e);
 
@@ -180,8 +217,11 @@ void PhysicsSystem(ECS *ecs, Entity e);
  * that have gravity enabled. Runs before PhysicsSystem.
  *
  * Required components: RigidBody
+ * Excluded components: Sleeping (when registered)
  *
- * Usage: System(ecs, GravitySystem, EcsOnFixedUpdate, RigidBody)
+ * Usage: SystemQuery(ecs, GravitySystem, EcsOnFixedUpdate,
+ *                    .with = EcsSignature(ecs, RigidBody),
+ *                    .without = EcsSignature(ecs, Sleeping))
  */
 void GravitySystem(ECS *ecs, Entity e);
 
@@ -189,16 +229,72 @@ void GravitySystem(ECS *ecs, Entity e);
 //  RENDERING  //
 // ########### //
 
+/**
+ * System that culls sprites outside the camera view.
+ *
+ * Runs once per frame on the entity holding the Camera2D and the RenderView.
+ * Computes the world rectangle seen by the camera, updates the sprite bounds
+ * in the RenderView grid and queries it: entities with a Sprite outside the
+ * view are culled, so EcsOnRender systems skip them. Gui systems and
+ * entities without Sprite are never culled.
+ *
+ * Without a window, set RenderView.screen to the size of the view.
+ *
+ * Required components: Camera2D, RenderView
+ * Processed entities: Sprite, Transform2
+ *
+ * Usage: System(ecs, CullingSystem, EcsOnPreRender, Camera2D, RenderView)
+ */
+void CullingSystem(ECS *ecs, Entity camera);
+
+/**
+ * System that updates the sort key of the entities with a RenderOrder.
+ *
+ * The key is z, or the y position plus z when ysort is set. Keys are only
+ * written when they change, so static entities don't sort their layer again.
+ *
+ * Required components: Transform2, RenderOrder
+ *
+ * Usage: System(ecs, RenderOrderSystem, EcsOnPreRender, Transform2,
+ *               RenderOrder)
+ *
+ * @see EntitySetSortKey()
+ */
+void RenderOrderSystem(ECS *ecs, Entity e);
+
 /**
  * System that renders sprite components.
  *
  * Draws textures for entities with Sprite components using their
  * Transform2 for positioning. Supports source rectangles and color tinting.
  *
+ * Draws immediately, in layer order. EcsWorld() uses SpriteBatchSystem
+ * instead.
+ *
  * Required components: Sprite, Transform2
  *
  * Usage: System(ecs, SpriteSystem, EcsOnRender, Sprite, Transform2)
  */
 void SpriteSystem(ECS *ecs, Entity e);
 
+/**
+ * System that records the visible sprites into the render queue.
+ *
+ * Runs once per frame on the entity holding the RenderView and the
+ * RenderQueue. Pushes a draw command for every visible sprite found by the
+ * CullingSystem, with the entity layer and its position in the layer
+ * (EntitySortIndex()). Nothing is drawn until the queue is flushed with
+ * RenderQueueFlush(), which sorts the commands in the layer order and
+ * batches the consecutive ones sharing a texture.
+ *
+ * Sprites with an Interpolation component are drawn between their last two
+ * fixed states, using the alpha of the camera FixedClock if it has one.
+ *
+ * Required components: RenderView, RenderQueue
+ * Processed entities: Sprite, Transform2 (visible ones), Interpolation
+ *
+ * Usage: System(ecs, SpriteBatchSystem, EcsOnRender, RenderView, RenderQueue)
+ */
+void SpriteBatchSystem(ECS *ecs, Entity camera);
+
 #endif
@@ -41,6 +41,110 @@
  */
 ECS *EcsWorld(void);
 
+/**
+ * Creates a pre-configured ECS world without window.
+ *
+ * Same components, systems and MainCamera entity as EcsWorld(), but no
+ * raylib window function is ever called: the view has a fixed 800x450
+ * screen, the render queue only records, and the behaviour render and GUI
+ * systems are not registered. Meant for dedicated servers, replay
+ * verification and benchmarks, driven with EcsStep().
+ *
+ * Running EcsOnPreRender and EcsOnRender then RenderQueueFlush() culls and
+ * sorts the sprites without drawing them, so the recorded draw list can be
+ * checked (WorldQueue(), WorldView()).
+ *
+ * @return Pointer to created ECS world, or NULL on failure.
+ *
+ * @note Don't run it with EcsLoop(), which needs a window.
+ *
+ * @see EcsStep() to advance the simulation
+ */
+ECS *EcsWorldHeadless(void);
+
+/**
+ * Advances the simulation of a world by dt seconds.
+ *
+ * Runs the EcsOnUpdate and EcsOnLateUpdate phases once, then EcsOnFixedUpdate
+ * as many times as EcsFixedDelta() fits in the accumulated time, up to the
+ * max_steps of the world FixedClock (see WorldClock()). No render
+ * phase is run and no window function is called, so it can be called in a
+ * tight loop to simulate faster than real time. EcsLoop() calls it every
+ * frame with GetFrameTime().
+ *
+ * A registry without a FixedClock on entity 0 (e.g. from EcsRegistry()) has
+ * no accumulator: each call runs EcsOnFixedUpdate exactly once.
+ *
+ * @param world The ECS world to advance.
+ * @param dt Elapsed time in seconds.
+ *
+ * Example:
+ * ```
+ * ECS *world = EcsWorldHeadless();
+ * EcsRunSystems(world, EcsOnStart);
+ * for (int tick = 0; tick < 3600; tick++)
+ *   EcsStep(world, FIXED_DELTATIME); // one minute, as fast as possible
+ * EcsFree(world);
+ * ```
+ */
+void EcsStep(ECS *world, float dt);
+
+/**
+ * Advances many worlds by dt seconds in parallel.
+ *
+ * Worlds share no state, so each EcsStep() runs as a separate task of the
+ * pool. The CPU time of every world is measured on the thread stepping it
+ * and stored in its FixedClock (see WorldClock()), which tells how densely
+ * worlds can be packed on the cores.
+ *
+ * A world with a threaded CollisionWorld keeps its own workers: they add to
+ * the threads of the pool, and their CPU time to the one of the world.
+ *
+ * @param worlds Worlds to advance (headless, see EcsWorldHeadless())
+ * @param count Number of worlds
+ * @param dt Elapsed time in seconds
+ * @param pool Pool running the steps, or NULL to step them in order
+ *
+ * Example:
+ * ```
+ * JobPool *pool = JobPoolCreate(8);
+ * while (running) {
+ *   EcsStepWorlds(matches, match_count, FIXED_DELTATIME, pool);
+ *   for (size_t i = 0; i < match_count; i++)
+ *     load[i] = WorldClock(matches[i])->cpu;
+ * }
+ * ```
+ */
+void EcsStepWorlds(ECS **worlds, size_t count, float dt, JobPool *pool);
+
+/**
+ * Runs the fixed steps of a world without touching its clock.
+ *
+ * Only EcsOnFixedUpdate runs: the accumulator, alpha and CPU time of the
+ * FixedClock are left as they are. Used to re-simulate after a rollback (see
+ * EcsLoadFrame()): the built-in fixed systems only read the fixed timestep
+ * and the registry, so replaying the same inputs from a restored frame gives
+ * the same state, as long as the fixed scripts don't read the clock either.
+ *
+ * @param world The ECS world to advance.
+ * @param steps Number of fixed steps.
+ */
+void EcsStepFixed(ECS *world, uint32_t steps);
+
+/**
+ * Hashes the simulation state of a world.
+ *
+ * Covers the entities with their Transform2, RigidBody and Collider (see
+ * EcsStateHash()). Compare it every tick between lockstep peers, or against
+ * the hashes recorded with a replay, to find the first tick that diverged.
+ * Results only match across builds and platforms when they are compiled
+ * with GEARECS_DETERMINISTIC (see simmath.h).
+ *
+ * @param world The ECS world to hash.
+ * @return 64-bit hash of the simulation state.
+ */
+uint64_t WorldStateHash(ECS *world);
+
 /**
  * Runs the main ECS game loop with proper phase ordering.
  *
@@ -69,4 +173,48 @@ void EcsLoop(ECS *world);
  */
 Camera2D *WorldMainCamera(ECS *ecs);
 
+/**
+ * @brief Retrieves the world collision state if exists.
+ *
+ * Gives access to the contacts found by the CollisionSystem on the current
+ * frame.
+ *
+ * @param ecs The ECS world registry.
+ * @return CollisionWorld component pointer or NULL if not found.
+ */
+CollisionWorld *WorldCollisions(ECS *ecs);
+
+/**
+ * @brief Retrieves the world render view if exists.
+ *
+ * Gives access to the camera rectangle and the visible and culled sprite
+ * counts computed by the CullingSystem on the current frame.
+ *
+ * @param ecs The ECS world registry.
+ * @return RenderView component pointer or NULL if not found.
+ */
+RenderView *WorldView(ECS *ecs);
+
+/**
+ * @brief Retrieves the world render queue if exists.
+ *
+ * Render systems may push their own draw commands to be sorted and batched
+ * with the sprites. The queue is flushed after the EcsOnRender phase.
+ *
+ * @param ecs The ECS world registry.
+ * @return RenderQueue component pointer or NULL if not found.
+ */
+RenderQueue *WorldQueue(ECS *ecs);
+
+/**
+ * @brief Retrieves the world fixed timestep state if exists.
+ *
+ * Holds the accumulator and the catch-up cap used by EcsStep(), and the
+ * interpolation factor of the current frame.
+ *
+ * @param ecs The ECS world registry.
+ * @return FixedClock component pointer or NULL if not found.
+ */
+FixedClock *WorldClock(ECS *ecs);
+
 #endif
@@ -0,0 +1,22 @@
+#ifndef MEM_CLOCK_H
+#define MEM_CLOCK_H
+
+/**
+ * @file clock.h
+ * @brief Monotonic wall clock for profiling
+ *
+ * Used to time the scopes of the profiler and of traces. It doesn't depend
+ * on raylib, so it also works in headless worlds.
+ */
+
+/**
+ * Gets a monotonic wall clock.
+ *
+ * Unlike JobThreadTime(), it counts the time a thread waits. Never goes
+ * back, even when the system time is changed.
+ *
+ * @return Time in seconds, from an arbitrary origin
+ */
+double ClockWallTime(void);
+
+#endif
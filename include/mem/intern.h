@@ -0,0 +1,122 @@
+#ifndef MEM_INTERN_H
+#define MEM_INTERN_H
+
+/**
+ * @file intern.h
+ * @brief Interned string table
+ *
+ * A StringTable copies each distinct string once into an arena and gives it
+ * a small integer id. Strings are hashed when interned: looking a string up
+ * again costs one hash and, on a hit, one compare. Interned strings never
+ * move, and are all freed at once with StringTableFree().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Id of an interned string, dense from 0 in interning order.
+ */
+typedef uint32_t StringID;
+
+/**
+ * Returned when a string is not interned.
+ */
+#define InvalidString ((StringID) - 1)
+
+typedef struct StringBlock StringBlock;
+
+/**
+ * Interned string metadata.
+ */
+typedef struct {
+  const char *str; ///< Null terminated copy in the arena
+  uint32_t hash;   ///< Hash of the string
+  uint32_t len;    ///< Length without the terminator
+} StringEntry;
+
+/**
+ * Registry-owned string interning table.
+ *
+ * Initialize with StringTableInit() and free with StringTableFree().
+ */
+typedef struct {
+  StringEntry *entries; ///< Interned strings indexed by id
+  StringID count;       ///< Number of interned strings
+  StringID alloc;       ///< Allocated entries
+  StringID *index;      ///< Open addressing hash index (internal)
+  size_t index_alloc;   ///< Index slots, power of two (internal)
+  StringBlock *blocks;  ///< Arena blocks, newest first (internal)
+} StringTable;
+
+/**
+ * Hashes a string (FNV-1a).
+ *
+ * @param str String to hash
+ * @param len Number of characters to hash
+ * @return 32 bit hash
+ */
+uint32_t StringHash(const char *str, size_t len);
+
+/**
+ * Initializes an empty table.
+ *
+ * @param table Table to initialize
+ */
+void StringTableInit(StringTable *table);
+
+/**
+ * Frees every interned string at once. The table can be used again.
+ *
+ * @param table Table to free
+ */
+void StringTableFree(StringTable *table);
+
+/**
+ * Interns a string, copying it if it's new.
+ *
+ * @param table Table owning the strings
+ * @param str Null terminated string
+ * @return Id of the string, or InvalidString if str is NULL or out of memory
+ */
+StringID StringIntern(StringTable *table, const char *str);
+
+/**
+ * Interns the first len characters of a string.
+ *
+ * @param table Table owning the strings
+ * @param str Characters to intern (not null terminated)
+ * @param len Number of characters
+ * @return Id of the string, or InvalidString if out of memory
+ */
+StringID StringInternN(StringTable *table, const char *str, size_t len);
+
+/**
+ * Finds an interned string without adding it.
+ *
+ * @param table Table owning the strings
+ * @param str Null terminated string
+ * @return Id of the string, or InvalidString if not interned
+ */
+StringID StringFind(const StringTable *table, const char *str);
+
+/**
+ * Finds the first len characters of a string without adding them.
+ *
+ * @param table Table owning the strings
+ * @param str Characters to find (not null terminated)
+ * @param len Number of characters
+ * @return Id of the string, or InvalidString if not interned
+ */
+StringID StringFindN(const StringTable *table, const char *str, size_t len);
+
+/**
+ * Gets an interned string.
+ *
+ * @param table Table owning the strings
+ * @param id Id of the string
+ * @return Null terminated copy, valid until StringTableFree(), or NULL
+ */
+const char *StringGet(const StringTable *table, StringID id);
+
+#endif
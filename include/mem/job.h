@@ -0,0 +1,130 @@
+#ifndef MEM_JOB_H
+#define MEM_JOB_H
+
+/**
+ * @file job.h
+ * @brief Minimal worker pool for data-parallel loops
+ *
+ * A JobPool keeps a fixed set of worker threads asleep until a parallel loop
+ * is submitted. Loops are split in batches of a fixed size: the batches don't
+ * depend on the number of threads, so a task that only writes to the outputs
+ * of its own batch gives the same result with any thread count.
+ *
+ * Threads are disabled when GEARECS_NO_THREADS is defined: every loop then
+ * runs on the calling thread.
+ *
+ * A pool runs one loop at a time: a loop submitted while another one runs
+ * (e.g. from one of its tasks) runs on the calling thread instead.
+ */
+
+#include <mem/trace.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Worker thread pool. Created with JobPoolCreate() and freed with
+ * JobPoolFree().
+ */
+typedef struct JobPool JobPool;
+
+/**
+ * Task run for each batch of a parallel loop.
+ *
+ * @param ctx User context given to JobParallelFor()
+ * @param begin First index of the batch
+ * @param end One past the last index of the batch
+ */
+typedef void (*JobTask)(void *ctx, size_t begin, size_t end);
+
+/**
+ * Creates a pool of worker threads.
+ *
+ * The calling thread also runs batches, so a pool of N threads starts N - 1
+ * workers.
+ *
+ * @param threads Number of threads running the loops (including the caller)
+ * @return Created pool, or NULL if threads <= 1 or threads are unavailable
+ */
+JobPool *JobPoolCreate(uint8_t threads);
+
+/**
+ * Stops the workers and frees the pool. Accepts NULL.
+ *
+ * @param pool Pool to free
+ */
+void JobPoolFree(JobPool *pool);
+
+/**
+ * Gets the number of threads running the loops of a pool.
+ *
+ * @param pool Pool to query (NULL is a single thread)
+ * @return Number of threads including the caller
+ */
+uint8_t JobPoolThreads(JobPool *pool);
+
+/**
+ * Gets the CPU time spent by the workers of a pool.
+ *
+ * Covers the worker threads only: the batches run by the calling thread
+ * count in its own JobThreadTime(). The difference between two calls, added
+ * to the time of the caller, gives the whole CPU cost of the loops run in
+ * between.
+ *
+ * @param pool Pool to query (NULL has no workers)
+ * @return CPU time in seconds since the pool was created
+ */
+double JobPoolWorkerTime(JobPool *pool);
+
+/**
+ * Attaches a trace to a pool.
+ *
+ * While the trace records, each batch run by the pool adds a scope ("Job", in
+ * category "job") on the track of the thread running it. Loops run on the
+ * caller without the pool (see JobParallelFor()) are not recorded.
+ *
+ * @param pool Pool to trace (NULL is ignored)
+ * @param trace Trace recording the batches, or NULL to detach it
+ */
+void JobPoolSetTrace(JobPool *pool, Trace *trace);
+
+/**
+ * Runs a task over [0, count) split in batches, and waits for all of them.
+ *
+ * Batches are claimed in order by the caller and the workers. Without a pool,
+ * or if the pool is busy with another loop, the batches run in order on the
+ * calling thread.
+ *
+ * @param pool Pool running the loop, or NULL to run it on the caller
+ * @param count Number of indices
+ * @param batch Number of indices per batch (0 is treated as 1)
+ * @param task Task run for each batch
+ * @param ctx User context given to the task
+ *
+ * Example:
+ * ```
+ * static void Integrate(void *ctx, size_t begin, size_t end) {
+ *   Particle *p = ctx;
+ *   for (size_t i = begin; i < end; i++)
+ *     p[i].position = Vector2Add(p[i].position, p[i].speed);
+ * }
+ *
+ * JobParallelFor(pool, count, 256, Integrate, particles);
+ * ```
+ */
+void JobParallelFor(JobPool *pool, size_t count, size_t batch, JobTask task,
+                    void *ctx);
+
+/**
+ * Gets the CPU time used by the calling thread.
+ *
+ * Unlike ClockWallTime(), the time a thread waits or is preempted doesn't
+ * count, so the difference between two calls measures the work done in
+ * between even when more tasks than cores are running. Falls back to the
+ * process CPU time where per-thread clocks are unavailable.
+ *
+ * @return CPU time in seconds, from an arbitrary origin
+ */
+double JobThreadTime(void);
+
+#endif
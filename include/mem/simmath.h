@@ -0,0 +1,60 @@
+#ifndef MEM_SIMMATH_H
+#define MEM_SIMMATH_H
+
+/**
+ * @file simmath.h
+ * @brief Math functions used by the simulation
+ *
+ * The fixed update systems call these instead of the libm functions. By
+ * default they are the libm functions. When GEARECS_DETERMINISTIC is
+ * defined, they are computed with the basic IEEE operations only (add, mul,
+ * div, floor), whose results don't depend on the platform, the libm or the
+ * compiler: every build gives the same bits for the same input.
+ *
+ * Basic operations (and sqrtf) are already exact, so the rest of the
+ * simulation only needs the compiler not to fuse them: deterministic builds
+ * are compiled with -ffp-contract=off (see the GEARECS_DETERMINISTIC CMake
+ * option).
+ */
+
+#include <math.h>
+
+#if defined(GEARECS_DETERMINISTIC)
+
+/**
+ * Sine of an angle, with the same result on every platform.
+ *
+ * Accurate to about one float ulp for angles up to a few thousand radians.
+ *
+ * @param x Angle in radians
+ * @return Sine of x
+ */
+float SimSinf(float x);
+
+/**
+ * Cosine of an angle, with the same result on every platform.
+ *
+ * @param x Angle in radians
+ * @return Cosine of x
+ *
+ * @see SimSinf()
+ */
+float SimCosf(float x);
+
+/**
+ * Exponential, with the same result on every platform.
+ *
+ * @param x Exponent
+ * @return e raised to x
+ */
+float SimExpf(float x);
+
+#else
+
+#define SimSinf(x) sinf(x)
+#define SimCosf(x) cosf(x)
+#define SimExpf(x) expf(x)
+
+#endif
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef MEM_STREAM_H
+#define MEM_STREAM_H
+
+/**
+ * @file stream.h
+ * @brief Growable byte buffer for binary serialization
+ *
+ * A Stream is written by appending raw blocks, and read back in the same
+ * order. Reading never copies when the caller only needs a view of the
+ * bytes (StreamView()), so a stream can wrap memory it doesn't own, like a
+ * file loaded in one read or mapped with StreamMap().
+ *
+ * Errors are sticky: once a read runs past the end or an allocation fails,
+ * the stream is marked as failed and every later call does nothing.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte buffer with a read position.
+ */
+typedef struct {
+  uint8_t *data; ///< Bytes of the stream
+  size_t size;   ///< Bytes written (readable)
+  size_t alloc;  ///< Allocated bytes, 0 when the memory isn't owned
+  size_t pos;    ///< Read position
+  bool failed;   ///< A read or an allocation failed
+  bool mapped;   ///< data is a read-only file mapping (StreamMap())
+} Stream;
+
+/**
+ * Creates a stream reading size bytes of external memory.
+ *
+ * The memory isn't copied nor freed by the stream.
+ *
+ * @param bytes Memory to read
+ * @param n Number of bytes
+ * @return Stream initializer
+ */
+#define StreamReader(bytes, n)                                                 \
+  ((Stream){(uint8_t *)(bytes), (n), 0, 0, false, false})
+
+/**
+ * Appends bytes at the end of a stream.
+ *
+ * @param s Stream to write (fails if it doesn't own its memory)
+ * @param src Bytes to copy
+ * @param n Number of bytes
+ * @return true on success
+ */
+bool StreamWrite(Stream *s, const void *src, size_t n);
+
+/**
+ * Appends formatted text at the end of a stream (printf format).
+ *
+ * The terminating null character isn't part of the stream size: the next
+ * write overwrites it.
+ *
+ * @param s Stream to write (fails if it doesn't own its memory)
+ * @param format printf format string
+ * @return true on success
+ */
+bool StreamPrintf(Stream *s, const char *format, ...);
+
+/**
+ * Appends text as a quoted JSON string.
+ *
+ * Quotes, backslashes and control characters are escaped. Other bytes are
+ * copied as they are, so UTF-8 text stays valid.
+ *
+ * @param s Stream to write (fails if it doesn't own its memory)
+ * @param text Null-terminated text (NULL writes an empty string)
+ * @return true on success
+ */
+bool StreamPrintJson(Stream *s, const char *text);
+
+/**
+ * Copies the next bytes of a stream.
+ *
+ * @param s Stream to read
+ * @param dest Destination of the bytes (zeroed on failure)
+ * @param n Number of bytes
+ * @return true on success, false if fewer than n bytes are left
+ */
+bool StreamRead(Stream *s, void *dest, size_t n);
+
+/**
+ * Gets the next bytes of a stream without copying them.
+ *
+ * @param s Stream to read
+ * @param n Number of bytes
+ * @return Pointer inside the stream, or NULL if fewer than n bytes are left
+ */
+const void *StreamView(Stream *s, size_t n);
+
+/**
+ * Appends an unsigned integer in 7-bit groups, lowest first.
+ *
+ * Small values take fewer bytes: below 128 a single one.
+ *
+ * @param s Stream to write
+ * @param value Value to encode
+ * @return true on success
+ */
+bool StreamWriteVarint(Stream *s, uint64_t value);
+
+/**
+ * Reads an integer written by StreamWriteVarint().
+ *
+ * @param s Stream to read
+ * @return Decoded value, 0 on failure
+ */
+uint64_t StreamReadVarint(Stream *s);
+
+/**
+ * Appends a float rounded to a multiple of step, as a signed varint.
+ *
+ * Values close to 0 relative to the step take one or two bytes. Infinite and
+ * NaN values are written as 0.
+ *
+ * @param s Stream to write
+ * @param value Value to encode
+ * @param step Precision of the encoded value
+ * @return true on success
+ */
+bool StreamWriteQuantized(Stream *s, float value, float step);
+
+/**
+ * Reads a float written by StreamWriteQuantized().
+ *
+ * @param s Stream to read
+ * @param step Precision given to StreamWriteQuantized()
+ * @return Decoded value, 0 on failure
+ */
+float StreamReadQuantized(Stream *s, float step);
+
+/**
+ * Pads a written stream with zeros up to a multiple of align bytes.
+ *
+ * Blocks written after it can be viewed in place as typed arrays when the
+ * stream memory itself is aligned (malloc, mmap).
+ *
+ * @param s Stream to write
+ * @param align Alignment in bytes
+ */
+void StreamPad(Stream *s, size_t align);
+
+/**
+ * Skips the padding written by StreamPad().
+ *
+ * @param s Stream to read
+ * @param align Alignment given to StreamPad()
+ */
+void StreamAlign(Stream *s, size_t align);
+
+/**
+ * Frees the memory owned by a stream, or unmaps its file, and empties it.
+ *
+ * @param s Stream to free
+ */
+void StreamFree(Stream *s);
+
+/**
+ * Writes the whole stream to a file.
+ *
+ * @param s Stream to save
+ * @param path File path
+ * @return true on success
+ */
+bool StreamSave(Stream *s, const char *path);
+
+/**
+ * Reads a whole file into an empty stream, with a single read.
+ *
+ * @param s Stream receiving the bytes (freed with StreamFree())
+ * @param path File path
+ * @return true on success
+ */
+bool StreamLoad(Stream *s, const char *path);
+
+/**
+ * Maps a whole file into an empty stream, without reading it.
+ *
+ * Pages are loaded by the system when they are first viewed, and shared with
+ * the file cache: opening a large file costs nothing until its blocks are
+ * used. The mapping is read-only, so the stream can't be written. Falls back
+ * to StreamLoad() where files can't be mapped.
+ *
+ * @param s Stream receiving the mapping (unmapped with StreamFree())
+ * @param path File path
+ * @return true on success
+ */
+bool StreamMap(Stream *s, const char *path);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef MEM_TRACE_H
+#define MEM_TRACE_H
+
+/**
+ * @file trace.h
+ * @brief Timeline capture in the Chrome trace format
+ *
+ * A Trace records timed scopes (a phase, a system, a fixed step, a job
+ * batch) from any thread into a fixed ring of events. Writers claim a slot
+ * with one atomic increment and never wait: when the ring is full the
+ * oldest events are overwritten, and an event whose slot is still being
+ * written by another thread (a whole ring ahead) is dropped.
+ *
+ * Each scope is stored as a single complete event (begin time and
+ * duration), so an overwritten ring never holds a begin without its end.
+ * TraceDump() writes the events as Chrome trace JSON, which opens in
+ * chrome://tracing and in Perfetto (ui.perfetto.dev).
+ *
+ * Nothing is recorded until TraceCapture() is called, and every function
+ * accepts a NULL trace, so instrumented code costs a pointer check when no
+ * trace is attached.
+ */
+
+#include <mem/stream.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Ring of timeline events. Created with TraceCreate() and freed with
+ * TraceFree().
+ */
+typedef struct Trace Trace;
+
+/**
+ * Creates a trace.
+ *
+ * @param capacity Number of events kept (the oldest are overwritten)
+ * @return Created trace, or NULL on failure
+ */
+Trace *TraceCreate(size_t capacity);
+
+/**
+ * Frees a trace. Accepts NULL.
+ *
+ * Nothing may record into the trace anymore (detach it first).
+ *
+ * @param trace Trace to free
+ */
+void TraceFree(Trace *trace);
+
+/**
+ * Clears the trace and records the next frames.
+ *
+ * Recording stops by itself once the frames are recorded (see TraceFrame()).
+ *
+ * @param trace Trace to record into
+ * @param frames Number of frames to record, 0 to record until TraceStop()
+ */
+void TraceCapture(Trace *trace, uint32_t frames);
+
+/**
+ * Stops recording. The events are kept until the next capture.
+ *
+ * @param trace Trace to stop
+ */
+void TraceStop(Trace *trace);
+
+/**
+ * Checks whether a trace is recording.
+ *
+ * @param trace Trace to check
+ * @return true while a capture is running
+ */
+bool TraceRecording(Trace *trace);
+
+/**
+ * Starts a frame of the capture. EcsStep() calls it before each step.
+ *
+ * Recording stops when the frame following the last recorded one starts, so
+ * the render phases run after a step are part of its frame.
+ *
+ * @param trace Trace being recorded
+ */
+void TraceFrame(Trace *trace);
+
+/**
+ * Starts a scope.
+ *
+ * @param trace Trace being recorded
+ * @return Start time, to give to TraceEnd()
+ */
+double TraceBegin(Trace *trace);
+
+/**
+ * Records a scope started with TraceBegin() on the calling thread.
+ *
+ * @param trace Trace being recorded
+ * @param name Name of the scope (not copied: a string literal)
+ * @param category Category of the scope (not copied), e.g. "system"
+ * @param start Value returned by TraceBegin()
+ *
+ * Example:
+ * ```
+ * double start = TraceBegin(trace);
+ * BuildNavMesh(level);
+ * TraceEnd(trace, "BuildNavMesh", "game", start);
+ * ```
+ */
+void TraceEnd(Trace *trace, const char *name, const char *category,
+              double start);
+
+/**
+ * Writes the recorded events as Chrome trace JSON.
+ *
+ * Times are in microseconds from the start of the capture. Each thread that
+ * recorded an event gets its own track.
+ *
+ * @param trace Trace to dump
+ * @param out Stream receiving the JSON (appended)
+ * @return true on success
+ */
+bool TraceDump(Trace *trace, Stream *out);
+
+#endif
@@ -1,6 +1,10 @@
 #include <ecs/component.h>
 
+#include <mem/array.h>
+#include <mem/simmath.h>
+
 #include <stdlib.h>
+#include <string.h>
 
 Collider ColliderCreate(int vertices, float radius, bool solid) {
   Collider col = {0};
@@ -11,7 +15,8 @@ Collider ColliderCreate(int vertices, float radius, bool solid) {
 
   float angle = PI * 2 / vertices;
   for (int i = 0; i < vertices; i++) {
-    col.vx[i] = (Vector2){radius * cosf(angle * i), radius * sinf(angle * i)};
+    col.vx[i] = (Vector2){radius * SimCosf(angle * i),
+                          radius * SimSinf(angle * i)};
     col.md[i] = col.vx[i];
   }
 
@@ -45,3 +50,135 @@ void ColliderDestructor(void *_self) {
   free(self->md);
   free(self->vx);
 }
+
+void ColliderSave(const void *_self, Stream *out) {
+  const Collider *self = (const Collider *)_self;
+  StreamWrite(out, self->vx, sizeof(Vector2) * self->vertices);
+  StreamWrite(out, self->md, sizeof(Vector2) * self->vertices);
+}
+
+void ColliderLoad(void *_self, Stream *in) {
+  Collider *self = (Collider *)_self;
+  self->vx = (Vector2 *)malloc(sizeof(Vector2) * self->vertices);
+  self->md = (Vector2 *)malloc(sizeof(Vector2) * self->vertices);
+  if (!self->vx || !self->md) {
+    free(self->vx);
+    free(self->md);
+    *self = (Collider){0};
+    return;
+  }
+  StreamRead(in, self->vx, sizeof(Vector2) * self->vertices);
+  StreamRead(in, self->md, sizeof(Vector2) * self->vertices);
+}
+
+void ColliderHash(const void *_self, Stream *out) {
+  const Collider *self = (const Collider *)_self;
+  StreamWrite(out, &self->vertices, sizeof(uint8_t));
+  StreamWrite(out, &self->solid, sizeof(bool));
+  StreamWrite(out, self->md, sizeof(Vector2) * self->vertices);
+}
+
+Contact *CollisionWorldFind(CollisionWorld *cw, Entity a, Entity b) {
+  if (a > b) {
+    Entity tmp = a;
+    a = b;
+    b = tmp;
+  }
+  uint32_t key = ((uint32_t)a << 16) | b;
+  size_t lo = 0, hi = cw->count;
+  while (lo < hi) {
+    size_t k = (lo + hi) / 2;
+    uint32_t ck = ((uint32_t)cw->contacts[k].a << 16) | cw->contacts[k].b;
+    if (ck == key)
+      return &cw->contacts[k];
+    if (ck < key)
+      lo = k + 1;
+    else
+      hi = k;
+  }
+  return NULL;
+}
+
+CollisionEvent *CollisionWorldEvents(CollisionWorld *cw, Entity self,
+                                     size_t *count) {
+  size_t lo = 0, hi = cw->event_count;
+  while (lo < hi) {
+    size_t k = (lo + hi) / 2;
+    if (cw->events[k].self < self)
+      lo = k + 1;
+    else
+      hi = k;
+  }
+  size_t end = lo;
+  while (end < cw->event_count && cw->events[end].self == self)
+    end++;
+
+  *count = end - lo;
+  return *count ? &cw->events[lo] : NULL;
+}
+
+void CollisionWorldDestructor(void *_self) {
+  CollisionWorld *self = (CollisionWorld *)_self;
+  free(self->contacts);
+  free(self->cache);
+  free(self->events);
+  free(self->islands);
+  free(self->order);
+  free(self->bodies);
+  free(self->sweep);
+  free(self->pairs);
+  JobPoolFree(self->jobs);
+}
+
+void CollisionWorldSave(const void *_self, Stream *out) {
+  const CollisionWorld *self = (const CollisionWorld *)_self;
+  uint64_t count = self->count;
+  StreamWrite(out, &count, sizeof(uint64_t));
+  StreamWrite(out, self->contacts, sizeof(Contact) * self->count);
+}
+
+void CollisionWorldLoad(void *_self, Stream *in) {
+  CollisionWorld *self = (CollisionWorld *)_self;
+  *self = (CollisionWorld){.iterations = self->iterations,
+                           .sleepSpeed = self->sleepSpeed,
+                           .sleepTime = self->sleepTime,
+                           .threads = self->threads};
+  uint64_t count = 0;
+  StreamRead(in, &count, sizeof(uint64_t));
+  if (count == 0 || count > (in->size - in->pos) / sizeof(Contact))
+    return;
+  const void *contacts = StreamView(in, sizeof(Contact) * count);
+  self->contacts = (Contact *)malloc(sizeof(Contact) * count);
+  if (!self->contacts)
+    return;
+  memcpy(self->contacts, contacts, sizeof(Contact) * count);
+  self->count = self->alloc = count;
+  // restored entities start at generation 0
+  for (size_t i = 0; i < count; i++)
+    self->contacts[i].ga = self->contacts[i].gb = 0;
+}
+
+void CollisionWorldRestore(void *_self, const void *_saved, Stream *in) {
+  CollisionWorld *self = (CollisionWorld *)_self, saved;
+  memcpy(&saved, _saved, sizeof(CollisionWorld));
+  self->iterations = saved.iterations;
+  self->sleepSpeed = saved.sleepSpeed;
+  self->sleepTime = saved.sleepTime;
+  self->threads = saved.threads;
+  self->count = self->cached = self->event_count = 0;
+  self->body_count = self->pair_count = self->island_count = 0;
+
+  uint64_t count = 0;
+  StreamRead(in, &count, sizeof(uint64_t));
+  if (count == 0 || count > (in->size - in->pos) / sizeof(Contact))
+    return;
+  const void *contacts = StreamView(in, sizeof(Contact) * count);
+  size_t alloc = MemEnsureCapacity((void **)&self->contacts, self->alloc,
+                                   count, sizeof(Contact));
+  if (!alloc)
+    return;
+  self->alloc = alloc;
+  // frames keep the entity generations, so the contacts keep theirs
+  memcpy(self->contacts, contacts, sizeof(Contact) * count);
+  self->count = count;
+}
@@ -13,6 +13,23 @@ void ChildrenDestructor(void *self) {
   }
 }
 
+void ChildrenSave(const void *self, Stream *out) {
+  const Children *children = (const Children *)self;
+  StreamWrite(out, children->list, sizeof(Entity) * children->count);
+}
+
+void ChildrenLoad(void *self, Stream *in) {
+  Children *children = (Children *)self;
+  Entity alloc = children->count > 4 ? children->count : 4;
+  children->list = (Entity *)malloc(sizeof(Entity) * alloc);
+  if (!children->list) {
+    *children = (Children){0};
+    return;
+  }
+  children->allocated = alloc;
+  StreamRead(in, children->list, sizeof(Entity) * children->count);
+}
+
 // Every parent operation will call the children operation with swapped entities
 // and change the parent component.
 //
@@ -1,17 +1,44 @@
 #include <ecs/component.h>
 
+#include <mem/simmath.h>
+
 void ApplyForce(RigidBody *rb, Vector2 force) {
+  if (force.x != 0 || force.y != 0)
+    WakeBody(rb);
   rb->acc.x += force.x / rb->mass;
   rb->acc.y += force.y / rb->mass;
 }
 
 void ApplyImpulse(RigidBody *rb, Vector2 impulse) {
+  if (impulse.x != 0 || impulse.y != 0)
+    WakeBody(rb);
   rb->speed.x += impulse.x / rb->mass;
   rb->speed.y += impulse.y / rb->mass;
 }
 
-void ApplyDamping(RigidBody *rb) {
-  float fac = expf(-rb->damping * FIXED_DELTATIME);
+void WakeBody(RigidBody *rb) {
+  if (!rb->sleeping)
+    return;
+  rb->sleeping = false;
+  rb->idle = 0;
+}
+
+void ApplyDamping(RigidBody *rb, float dt) {
+  float fac = SimExpf(-rb->damping * dt);
   rb->speed.x *= fac;
   rb->speed.y *= fac;
 }
+
+void RigidBodyHash(const void *_self, Stream *out) {
+  const RigidBody *self = (const RigidBody *)_self;
+  uint8_t type = (uint8_t)self->type;
+  float values[4] = {self->mass, self->invmass, self->damping,
+                     self->restitution};
+  Vector2 vectors[3] = {self->speed, self->acc, self->origin};
+  bool flags[3] = {self->gravity, self->ccd, self->sleeping};
+  StreamWrite(out, &type, sizeof(uint8_t));
+  StreamWrite(out, values, sizeof(values));
+  StreamWrite(out, vectors, sizeof(vectors));
+  StreamWrite(out, flags, sizeof(flags));
+  StreamWrite(out, &self->idle, sizeof(float));
+}
@@ -0,0 +1,98 @@
+#include <ecs/component.h>
+
+#include <mem/array.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void RenderQueuePush(RenderQueue *queue, DrawCommand command) {
+  queue->alloc = MemPushBack((void **)&queue->commands, queue->alloc,
+                             queue->count++, &command, sizeof(DrawCommand));
+}
+
+// Textures aren't part of the key: reordering sprites by texture would change
+// which of two overlapping sprites is drawn on top.
+static uint32_t CommandKey(DrawCommand *c) {
+  return (uint32_t)c->layer << 24 | (c->sort & 0xFFFFFF);
+}
+
+// LSD radix sort, 8 bits per pass. Passes where every key has the same byte
+// are skipped, which is the common case for the layer and sort bytes.
+static void RadixSort(RenderSortItem *items, RenderSortItem *scratch,
+                      size_t count) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    size_t offsets[256] = {0};
+    for (size_t i = 0; i < count; i++)
+      offsets[(items[i].key >> shift) & 0xFF]++;
+    if (offsets[(items[0].key >> shift) & 0xFF] == count)
+      continue;
+
+    size_t total = 0;
+    for (int b = 0; b < 256; b++) {
+      size_t n = offsets[b];
+      offsets[b] = total;
+      total += n;
+    }
+    for (size_t i = 0; i < count; i++)
+      scratch[offsets[(items[i].key >> shift) & 0xFF]++] = items[i];
+    memcpy(items, scratch, count * sizeof(RenderSortItem));
+  }
+}
+
+static void SortCommands(RenderQueue *queue) {
+  size_t count = queue->count;
+  if (count > queue->sort_alloc) {
+    size_t alloc = queue->sort_alloc ? queue->sort_alloc : 64;
+    while (alloc < count)
+      alloc *= 2;
+    free(queue->sorted);
+    free(queue->items);
+    free(queue->scratch);
+    queue->sorted = malloc(alloc * sizeof(DrawCommand));
+    queue->items = malloc(alloc * sizeof(RenderSortItem));
+    queue->scratch = malloc(alloc * sizeof(RenderSortItem));
+    queue->sort_alloc = alloc;
+    if (!queue->sorted || !queue->items || !queue->scratch) {
+      queue->sort_alloc = 0;
+      return; // draw in submission order
+    }
+  }
+
+  for (size_t i = 0; i < count; i++)
+    queue->items[i] = (RenderSortItem){CommandKey(&queue->commands[i]), i};
+  RadixSort(queue->items, queue->scratch, count);
+  for (size_t i = 0; i < count; i++)
+    queue->sorted[i] = queue->commands[queue->items[i].index];
+  memcpy(queue->commands, queue->sorted, count * sizeof(DrawCommand));
+}
+
+void RenderQueueFlush(RenderQueue *queue) {
+  if (queue->count > 1)
+    SortCommands(queue);
+
+  queue->batches = 0;
+  for (size_t i = 0; i < queue->count; i++) {
+    DrawCommand *c = &queue->commands[i];
+    if (i == 0 || c->tex.id != queue->commands[i - 1].tex.id)
+      queue->batches++;
+    if (!queue->headless)
+      DrawTexturePro(c->tex, c->src, c->dest, c->origin, c->rotation, c->tint);
+  }
+
+  queue->drawn = queue->count;
+  queue->count = 0;
+}
+
+void RenderQueueDestructor(void *_self) {
+  RenderQueue *self = (RenderQueue *)_self;
+  free(self->commands);
+  free(self->sorted);
+  free(self->items);
+  free(self->scratch);
+}
+
+void RenderQueueLoad(void *_self, Stream *in) {
+  (void)in;
+  RenderQueue *self = (RenderQueue *)_self;
+  *self = (RenderQueue){.headless = self->headless};
+}
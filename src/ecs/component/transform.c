@@ -0,0 +1,45 @@
+#include <ecs/component.h>
+
+Transform2 TransformInterpolate(Transform2 *t, Interpolation *prev,
+                                float alpha) {
+  Transform2 out = *t;
+  out.position = Vector2Lerp(prev->position, t->position, alpha);
+  out.rotation = Lerp(prev->rotation, t->rotation, alpha);
+  return out;
+}
+
+#define TRANSFORM_POSITION (1.f / 64)
+#define TRANSFORM_ROTATION (1.f / 4096)
+#define TRANSFORM_SCALE (1.f / 1024)
+
+static void EncodeVector(Stream *out, Vector2 v, float step) {
+  StreamWriteQuantized(out, v.x, step);
+  StreamWriteQuantized(out, v.y, step);
+}
+
+static Vector2 DecodeVector(Stream *in, float step) {
+  Vector2 v;
+  v.x = StreamReadQuantized(in, step);
+  v.y = StreamReadQuantized(in, step);
+  return v;
+}
+
+void TransformEncode(const void *self, Stream *out) {
+  const Transform2 *t = (const Transform2 *)self;
+  EncodeVector(out, t->position, TRANSFORM_POSITION);
+  EncodeVector(out, t->scale, TRANSFORM_SCALE);
+  StreamWriteQuantized(out, t->rotation, TRANSFORM_ROTATION);
+  EncodeVector(out, t->localPosition, TRANSFORM_POSITION);
+  EncodeVector(out, t->localScale, TRANSFORM_SCALE);
+  StreamWriteQuantized(out, t->localRotation, TRANSFORM_ROTATION);
+}
+
+void TransformDecode(void *self, Stream *in) {
+  Transform2 *t = (Transform2 *)self;
+  t->position = DecodeVector(in, TRANSFORM_POSITION);
+  t->scale = DecodeVector(in, TRANSFORM_SCALE);
+  t->rotation = StreamReadQuantized(in, TRANSFORM_ROTATION);
+  t->localPosition = DecodeVector(in, TRANSFORM_POSITION);
+  t->localScale = DecodeVector(in, TRANSFORM_SCALE);
+  t->localRotation = StreamReadQuantized(in, TRANSFORM_ROTATION);
+}
@@ -0,0 +1,22 @@
+#include <ecs/component.h>
+
+#include <stdlib.h>
+
+void RenderViewDestructor(void *_self) {
+  RenderView *self = (RenderView *)_self;
+  for (size_t i = 0; i < self->cell_alloc; i++)
+    free(self->cells[i].entities);
+  free(self->cells);
+  free(self->large.entities);
+  free(self->proxies);
+  free(self->list);
+}
+
+void RenderViewLoad(void *_self, Stream *in) {
+  (void)in;
+  RenderView *self = (RenderView *)_self;
+  *self = (RenderView){.cell = self->cell,
+                       .screen = self->screen,
+                       .frame = self->frame,
+                       .background = self->background};
+}
@@ -1,11 +1,12 @@
 #include <ecs/registry.h>
 
 #include <mem/array.h>
+#include <mem/intern.h>
+#include <mem/clock.h>
 
 // vi :170
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,55 +14,133 @@
 #define MaxEntities 65355
 
 typedef struct {
-  Component id;
-  char *name;
-} ComponentID;
+  Component component; // InvalidID if the name isn't a component
+  TagID tag;           // InvalidID if the name isn't a tag
+  Layer layer;         // InvalidLayer if the name isn't a layer
+} NameRefs;
 
 typedef struct {
   void *list;
   size_t size;
   void (*dtor)(void *);
-  Component alloc;
+  size_t alloc;
+  const char *name; // Interned
+  ComponentSave save;
+  ComponentLoad load;
+  bool hooked; // Serialization hooks registered
+  ComponentSave encode; // Delta hooks, NULL to send the raw bytes
+  ComponentLoad decode;
+  uint32_t *versions; // Tick of the last write (per entity)
+  size_t versioned;   // Allocated versions
+  ComponentSave hash; // State hash hook, NULL to hash the raw bytes
+  ComponentRestore restore; // Rollback hook, NULL to destroy and load
 } ComponentData;
 
+#if defined(GEARECS_PROFILE)
+typedef struct {
+  double time;
+  uint32_t calls;
+  uint32_t visited;
+  uint32_t matched;
+} ProfileSample;
+
+// Closed frames of the window, plus the frame being recorded
+typedef ProfileSample ProfileRing[ProfileWindow + 1];
+#endif
+
 typedef struct {
   System *list;
   EcsID size;
   EcsID alloc;
+#if defined(GEARECS_PROFILE)
+  ProfileRing *profile; // Per system, same order as the list
+  ProfileRing total;    // Whole phase
+#endif
 } PhaseSystem;
 
 typedef struct {
-  char *name;
-  Signature mask;
-} Layer;
+  const char *name; // Interned
+} LayerInfo;
+
+typedef struct {
+  const char *name; // Interned
+  Entity *entities; // Entities with this tag (unordered)
+  Entity count;
+  size_t alloc;
+} TagInfo;
+
+typedef struct {
+  Entity entity; // InvalidID once removed
+  float key;     // Render order inside the layer
+} LayerEntry;
 
 typedef struct {
-  Entity *entities;
+  LayerEntry *entries; // Sorted by key, then insertion order
   Entity count;
-  Entity alloc;
+  size_t alloc;
+  Entity holes; // Removed entries not compacted yet
+  bool dirty;   // Needs compaction, sorting or ranking
 } LayerEntities;
 
+typedef struct {
+  EcsID slot;    // Index in the layer entries, InvalidID if none
+  uint16_t rank; // Rank of the key in the layer (equal keys, equal rank)
+  float key;     // Render order inside the layer
+} RenderSlot;
+
 struct Registry {
 
   EntityData *entities; // EntityData - GameObjects
   Entity entity_count;
-  Entity entity_alloc;
+  size_t entity_alloc;
 
   Entity *free_entities; // Free entities stack
   Entity free_count;
-  Entity free_alloc;
+  size_t free_alloc;
 
   ComponentData *components; // Component matrix
-  ComponentID *search;       // Component tree search (id+name)
   Component comp_count;
   Component comp_alloc;
 
   PhaseSystem *systems; // Systems with phases
 
-  Layer *layers;         // Layer stack (order + collision)
-  LayerEntities *render; // Render entities stack
+  LayerInfo *layers;            // Layer stack (render order)
+  Signature collide[MaxLayers]; // Collision bit matrix (row per layer)
+  LayerEntities *render;        // Render entities stack
   EcsID layer_count;
   EcsID layer_alloc;
+
+  float fixed_delta; // Timestep of the FixedUpdate phase
+
+  size_t match_words; // Words of every system match and state bitset
+  uint64_t *alive;    // State bitsets (bit per entity)
+  uint64_t *active;
+  uint64_t *visible;
+  uint64_t *culled;
+
+  uint32_t tick;    // Change tick stamped on writes
+  uint32_t *shaped; // Tick of the last structural change (per entity)
+  uint32_t *born;   // Tick of the creation (per entity)
+  uint32_t *chunks; // Tick of the last change (per match word)
+
+  RenderSlot *slots; // Layer index map (entity -> entry)
+  Entity slot_alloc;
+
+  TagInfo *tags;     // Interned tags, never removed
+  TagID tag_count;
+  TagID tag_alloc;
+  Entity *tag_slots; // Position in the tag entity list (entity -> slot)
+  size_t tag_slot_alloc;
+
+  StringTable names; // Component, layer and tag names
+  NameRefs *refs;    // What each name refers to (string -> ids)
+  StringID ref_alloc;
+
+  Trace *trace; // Timeline capture, NULL when not traced
+
+#if defined(GEARECS_PROFILE)
+  uint32_t profile_frame; // Frames ended by EcsProfileFrame()
+#endif
 };
 
 // ###### //
@@ -70,13 +149,13 @@ struct Registry {
 
 void EcsLogStatus(ECS *ecs) {
   printf("ECS Registry: {\n  Entity: {\n");
-  printf("    Alive: %u (alloc:%u)\n", ecs->entity_count, ecs->entity_alloc);
-  printf("    Free: %u (alloc:%u)\n", ecs->free_count, ecs->free_alloc);
+  printf("    Alive: %u (alloc:%zu)\n", ecs->entity_count, ecs->entity_alloc);
+  printf("    Free: %u (alloc:%zu)\n", ecs->free_count, ecs->free_alloc);
   printf("  },\n  Components: {\n");
   printf("    List: %u (alloc:%u) [\n", ecs->comp_count, ecs->comp_alloc);
   for (Component i = 0; i < ecs->comp_count; i++)
-    printf("      {id: %u, name: %s},\n", ecs->search[i].id,
-           ecs->search[i].name);
+    printf("      {id: %u, name: %s, size: %zu},\n", i,
+           ecs->components[i].name, ecs->components[i].size);
   printf("    ],\n  },\n  Systems: {\n    List: %d [\n", EcsTotalPhases);
   for (int i = 0; i < EcsTotalPhases; i++)
     printf("      {phase: %d, count: %u, alloc: %u},\n", i,
@@ -84,9 +163,9 @@ void EcsLogStatus(ECS *ecs) {
   printf("    ],\n  },\n  Layers: len:%u (alloc:%u) [\n", ecs->layer_count,
          ecs->layer_alloc);
   for (EcsID i = 0; i < ecs->layer_count; i++)
-    printf("      {name: %s, entities: %d (alloc: %d), mask: %lb},\n",
+    printf("      {name: %s, entities: %d (alloc: %zu), mask: %lb},\n",
            ecs->layers[i].name, ecs->render[i].count, ecs->render[i].alloc,
-           ecs->layers[i].mask);
+           ecs->collide[i]);
   printf("    ],\n  },\n}\n");
 }
 
@@ -105,6 +184,24 @@ static void EcsInitEntities(ECS *ecs) {
   ecs->render = NULL;
   ecs->layer_count = 0;
   ecs->layer_alloc = 0;
+  for (Layer i = 0; i < MaxLayers; i++)
+    ecs->collide[i] = (Signature)-1; // all enabled
+  ecs->match_words = 0;
+  ecs->alive = NULL;
+  ecs->active = NULL;
+  ecs->visible = NULL;
+  ecs->culled = NULL;
+  ecs->tick = 1;
+  ecs->shaped = NULL;
+  ecs->born = NULL;
+  ecs->chunks = NULL;
+  ecs->slots = NULL;
+  ecs->slot_alloc = 0;
+  ecs->tags = NULL;
+  ecs->tag_count = 0;
+  ecs->tag_alloc = 0;
+  ecs->tag_slots = NULL;
+  ecs->tag_slot_alloc = 0;
 }
 
 static void EcsFreeEntities(ECS *ecs) {
@@ -118,10 +215,11 @@ static void EcsFreeEntities(ECS *ecs) {
   ecs->free_alloc = 0;
   if (ecs->layers) {
     for (int i = 0; i < ecs->layer_count; i++) {
-      if (ecs->render[i].entities)
-        free(ecs->render[i].entities);
+      if (ecs->render[i].entries)
+        free(ecs->render[i].entries);
       ecs->render[i].count = 0;
       ecs->render[i].alloc = 0;
+      ecs->collide[i] = (Signature)-1;
     }
     free(ecs->layers);
     free(ecs->render);
@@ -130,6 +228,33 @@ static void EcsFreeEntities(ECS *ecs) {
     ecs->layer_count = 0;
     ecs->layer_alloc = 0;
   }
+  free(ecs->alive);
+  free(ecs->active);
+  free(ecs->visible);
+  free(ecs->culled);
+  ecs->alive = NULL;
+  ecs->active = NULL;
+  ecs->visible = NULL;
+  ecs->culled = NULL;
+  free(ecs->shaped);
+  free(ecs->born);
+  free(ecs->chunks);
+  ecs->shaped = NULL;
+  ecs->born = NULL;
+  ecs->chunks = NULL;
+  ecs->match_words = 0;
+  free(ecs->slots);
+  ecs->slots = NULL;
+  ecs->slot_alloc = 0;
+  for (TagID i = 0; i < ecs->tag_count; i++)
+    free(ecs->tags[i].entities);
+  free(ecs->tags);
+  free(ecs->tag_slots);
+  ecs->tags = NULL;
+  ecs->tag_count = 0;
+  ecs->tag_alloc = 0;
+  ecs->tag_slots = NULL;
+  ecs->tag_slot_alloc = 0;
 }
 
 static void EcsInitComponents(ECS *ecs) {
@@ -138,19 +263,22 @@ static void EcsInitComponents(ECS *ecs) {
   ecs->comp_count = 0;
 }
 
+static void RemoveComponentData(ECS *ecs, Entity e, Component id);
+
 void EcsFreeComponents(ECS *ecs) {
   while (ecs->comp_count > 0) {
     Component id = ecs->comp_count - 1;
     for (Entity e = 0; e < ecs->components[id].alloc && e < ecs->entity_count;
          ++e)
-      EcsRemoveComponent(ecs, e, id);
+      if (EcsHasComponent(ecs, e, id))
+        RemoveComponentData(ecs, e, id);
 
     free(ecs->components[id].list);
+    free(ecs->components[id].versions);
     ecs->components[id].list = NULL;
     ecs->comp_count--;
   }
   free(ecs->components);
-  free(ecs->search);
   ecs->components = NULL;
   ecs->comp_alloc = 0;
 }
@@ -160,8 +288,14 @@ static void EcsInitSystems(ECS *ecs) {
 }
 
 void EcsFreeSystems(ECS *ecs) {
-  for (int i = 0; i < EcsTotalPhases; i++)
+  for (int i = 0; i < EcsTotalPhases; i++) {
+    for (EcsID s = 0; s < ecs->systems[i].size; s++)
+      free(ecs->systems[i].list[s].match);
     free(ecs->systems[i].list);
+#if defined(GEARECS_PROFILE)
+    free(ecs->systems[i].profile);
+#endif
+  }
   free(ecs->systems);
   ecs->systems = NULL;
 }
@@ -175,6 +309,14 @@ ECS *EcsRegistry(void) {
   EcsInitEntities(ecs);
   EcsInitComponents(ecs);
   EcsInitSystems(ecs);
+  StringTableInit(&ecs->names);
+  ecs->fixed_delta = FIXED_DELTATIME;
+  ecs->refs = NULL;
+  ecs->ref_alloc = 0;
+  ecs->trace = NULL;
+#if defined(GEARECS_PROFILE)
+  ecs->profile_frame = 0;
+#endif
   return ecs;
 }
 
@@ -182,55 +324,133 @@ void EcsFree(ECS *ecs) {
   EcsFreeSystems(ecs);
   EcsFreeComponents(ecs);
   EcsFreeEntities(ecs);
+  StringTableFree(&ecs->names);
+  free(ecs->refs);
   free(ecs);
   printf("GEARECS: Registry freed successfully!\n");
 }
 
+// ####### //
+//  NAMES  //
+// ####### //
+
+// Interns a name. The pointer is valid until the next interned name.
+static NameRefs *EcsName(ECS *ecs, const char *name) {
+  StringID id = StringIntern(&ecs->names, name);
+  if (id == InvalidString)
+    return NULL;
+  if (id >= ecs->ref_alloc) {
+    StringID alloc = ecs->ref_alloc ? ecs->ref_alloc * 2 : 64;
+    NameRefs *refs = realloc(ecs->refs, alloc * sizeof(NameRefs));
+    if (!refs)
+      return NULL;
+    for (StringID i = ecs->ref_alloc; i < alloc; i++)
+      refs[i] = (NameRefs){InvalidID, InvalidID, InvalidLayer};
+    ecs->refs = refs;
+    ecs->ref_alloc = alloc;
+  }
+  return &ecs->refs[id];
+}
+
+static NameRefs *EcsFindName(ECS *ecs, const char *name) {
+  StringID id = StringFind(&ecs->names, name);
+  return id == InvalidString ? NULL : &ecs->refs[id];
+}
+
+static const char *EcsNameString(ECS *ecs, NameRefs *refs) {
+  return StringGet(&ecs->names, (StringID)(refs - ecs->refs));
+}
+
 // ######## //
 //  ENTITY  //
 // ######## //
 
-void AddEntityToLayer(ECS *ecs, Entity e, uint8_t ly);
+void AddEntityToLayer(ECS *ecs, Entity e, Layer ly);
 void RemoveEntityFromLayer(ECS *ecs, Entity e);
+static void LayerSort(ECS *ecs, LayerEntities *le);
+static void AddEntityToTag(ECS *ecs, Entity e, const char *tag);
+static void RemoveEntityFromTag(ECS *ecs, Entity e);
+static void EcsMatchEntity(ECS *ecs, Entity e, bool alive);
+static void EcsMatchChanged(ECS *ecs, Entity e, Signature changed);
+static bool EcsMatchReserve(ECS *ecs, Entity e);
+
+#define StateGet(bits, e) ((bits)[(e) / 64] >> ((e) % 64) & 1)
+
+static void StateSet(uint64_t *bits, Entity e, bool value) {
+  if (value)
+    bits[e / 64] |= 1ULL << (e % 64);
+  else
+    bits[e / 64] &= ~(1ULL << (e % 64));
+}
 
-Entity EcsEntity(ECS *ecs, char *tag) {
-  Entity e;
-  if (ecs->free_count > 0) {
-    e = ecs->free_entities[--ecs->free_count];
-  } else {
-    if (ecs->entity_count >= MaxEntities)
-      return InvalidID;
-    e = ecs->entity_count;
-  }
+// Stamps a change of an entity with the current tick. The entity bits must
+// be reserved.
+static void EcsStamp(ECS *ecs, Entity e, uint32_t *version) {
+  *version = ecs->tick;
+  ecs->chunks[e / 64] = ecs->tick;
+}
+
+// Brings an unused entity to life. Its bits must be reserved.
+static void EntityInit(ECS *ecs, Entity e, const char *tag,
+                       uint32_t generation) {
   assert(e < MaxEntities && "Exceeded maximum number of entities");
-  EntityData ed = {0, true, true, tag, 0};
-  Entity alloc = MemPushBack((void **)&ecs->entities, ecs->entity_alloc, e, &ed,
+  StateSet(ecs->alive, e, true);
+  StateSet(ecs->active, e, true);
+  StateSet(ecs->visible, e, true);
+  StateSet(ecs->culled, e, false);
+  EntityData ed = {0, NULL, InvalidID, 0, generation};
+  size_t alloc = MemPushBack((void **)&ecs->entities, ecs->entity_alloc, e, &ed,
                              sizeof(EntityData));
   // if (alloc == 0) // this should never happend
   //   return InvalidID;
   ecs->entity_alloc = alloc;
-  ecs->entity_count++;
   AddEntityToLayer(ecs, e, 0);
+  AddEntityToTag(ecs, e, tag);
+  EcsMatchEntity(ecs, e, true);
+  ecs->born[e] = ecs->tick;
+}
+
+Entity EcsEntity(ECS *ecs, const char *tag) {
+  Entity e;
+  uint32_t generation = 0;
+  if (ecs->free_count > 0) {
+    e = ecs->free_entities[--ecs->free_count];
+    generation = ecs->entities[e].generation;
+  } else {
+    // freed entities already have their bits
+    if (ecs->entity_count >= MaxEntities ||
+        !EcsMatchReserve(ecs, ecs->entity_count))
+      return InvalidID;
+    e = ecs->entity_count++;
+  }
+  EntityInit(ecs, e, tag, generation);
   return e;
 }
 
 bool EcsEntityIsAlive(ECS *ecs, Entity e) {
-  for (Entity i = 0; i < ecs->free_count; i++)
-    if (ecs->free_entities[i] == e)
-      return false;
-  return true;
+  return e < ecs->entity_count && StateGet(ecs->alive, e);
 }
 
 void EcsEntityFree(ECS *ecs, Entity e) {
   // Remove all components with proper cleanup
   for (Component c = 0; c < ecs->comp_count; c++)
-    EcsRemoveComponent(ecs, e, c);
+    if (EcsHasComponent(ecs, e, c))
+      RemoveComponentData(ecs, e, c);
+  EcsMatchEntity(ecs, e, false);
   RemoveEntityFromLayer(ecs, e);
-  ecs->entities[e] = (EntityData){0};
+  RemoveEntityFromTag(ecs, e);
+  if (e < ecs->slot_alloc)
+    ecs->slots[e].key = 0;
+  ecs->entities[e] = (EntityData){0, NULL, InvalidID, 0,
+                                  ecs->entities[e].generation + 1};
+  StateSet(ecs->alive, e, false);
+  StateSet(ecs->active, e, false);
+  StateSet(ecs->visible, e, false);
+  StateSet(ecs->culled, e, false);
 
   // if (ecs->free_count < MaxEntities) {
-  Entity alloc = MemPushBack((void **)&ecs->free_entities, ecs->free_alloc,
-                                ecs->free_count, &e, sizeof(Entity));
+  size_t alloc = MemPushBack((void **)&ecs->free_entities, ecs->free_alloc,
+                             ecs->free_count, &e, sizeof(Entity));
   ecs->free_alloc = alloc;
   ecs->free_count++;
   // }
@@ -238,9 +458,11 @@ void EcsEntityFree(ECS *ecs, Entity e) {
 
 Entity EcsEntityCount(ECS *ecs) { return ecs->entity_count - ecs->free_count; }
 
+Entity EcsEntityEnd(ECS *ecs) { return ecs->entity_count; }
+
 void EcsForEachEntity(ECS *ecs, Script script) {
   for (Entity e = 0; e < ecs->entity_count; e++) {
-    if (!EcsEntityIsAlive(ecs, e))
+    if (!StateGet(ecs->alive, e))
       continue;
     script(ecs, e);
   }
@@ -256,109 +478,146 @@ EntityData *EcsEntityData(ECS *ecs, Entity e) {
   return &ecs->entities[e];
 }
 
-Entity EntityFindByTag(ECS *ecs, char *tag) {
-  for (Entity e = 0; e < ecs->comp_count; e++) {
-    if (strcmp(ecs->entities[e].tag, tag) == 0)
-      return e;
-  }
-  return InvalidID;
+void EntitySetActive(ECS *ecs, Entity e, bool active) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  StateSet(ecs->active, e, active);
 }
 
-bool EntityHasTag(ECS *ecs, Entity e, char *tag) {
+bool EntityIsActive(ECS *ecs, Entity e) {
   assert(e < MaxEntities && "Invalid entity");
   assert(e < ecs->entity_count && "Entity does not exist");
-  return strcmp(ecs->entities[e].tag, tag) == 0;
+  return StateGet(ecs->active, e);
 }
 
-void EntitySetActive(ECS *ecs, Entity e, bool active) {
+void EntitySetVisible(ECS *ecs, Entity e, bool visible) {
   assert(e < MaxEntities && "Invalid entity");
   assert(e < ecs->entity_count && "Entity does not exist");
-  ecs->entities[e].active = active;
+  StateSet(ecs->visible, e, visible);
 }
 
-bool EntityIsActive(ECS *ecs, Entity e) {
+bool EntityIsVisible(ECS *ecs, Entity e) {
   assert(e < MaxEntities && "Invalid entity");
   assert(e < ecs->entity_count && "Entity does not exist");
-  return ecs->entities[e].active;
+  return StateGet(ecs->visible, e);
 }
 
-void EntitySetVisible(ECS *ecs, Entity e, bool visible) {
+void EntitySetCulled(ECS *ecs, Entity e, bool culled) {
   assert(e < MaxEntities && "Invalid entity");
   assert(e < ecs->entity_count && "Entity does not exist");
-  ecs->entities[e].visible = visible;
+  StateSet(ecs->culled, e, culled);
 }
 
-bool EntityIsVisible(ECS *ecs, Entity e) {
+bool EntityIsCulled(ECS *ecs, Entity e) {
   assert(e < MaxEntities && "Invalid entity");
   assert(e < ecs->entity_count && "Entity does not exist");
-  return ecs->entities[e].visible;
+  return StateGet(ecs->culled, e);
 }
 
 // ########### //
 //  COMPONENT  //
 // ########### //
 
-int comp(const void *a, const void *b) {
-  return strcmp(((ComponentID *)a)->name, ((ComponentID *)b)->name);
-}
-
-Component EcsComponent(ECS *ecs, char *name, size_t size,
+Component EcsComponent(ECS *ecs, const char *name, size_t size,
                        void (*dtor)(void *)) {
+  NameRefs *refs = EcsName(ecs, name);
+  if (!refs)
+    return InvalidID;
+  if (refs->component != InvalidID)
+    return refs->component;
   // maximum number of components for signatures
   if (ecs->comp_count >= 64)
     return InvalidID;
 
   Component id = ecs->comp_count;
-  Component count = ecs->comp_count;
-  Component alloc = ecs->comp_alloc;
-
-  ComponentData component = {NULL, size, dtor, 0};
-  ComponentID compid = {id, name};
-
-  MemPushBack((void **)&ecs->components, alloc, count, &component,
-                 sizeof(ComponentData));
-  alloc = MemPushBack((void **)&ecs->search, alloc, count, &compid,
-                         sizeof(ComponentID));
-
-  ecs->comp_alloc = alloc;
+  ComponentData component = {
+      .size = size, .dtor = dtor, .name = EcsNameString(ecs, refs)};
+  ecs->comp_alloc = MemPushBack((void **)&ecs->components, ecs->comp_alloc,
+                                ecs->comp_count, &component,
+                                sizeof(ComponentData));
   ecs->comp_count++;
-
-  qsort(ecs->search, ecs->comp_count, sizeof(ComponentID), comp);
+  refs->component = id;
   return id;
 }
 
+// Versions follow the allocation of the column.
+static bool ComponentVersions(ComponentData *c) {
+  if (c->versioned >= c->alloc)
+    return true;
+  uint32_t *versions = realloc(c->versions, c->alloc * sizeof(uint32_t));
+  if (!versions)
+    return false;
+  memset(versions + c->versioned, 0,
+         (c->alloc - c->versioned) * sizeof(uint32_t));
+  c->versions = versions;
+  c->versioned = c->alloc;
+  return true;
+}
+
 void EcsAddComponent(ECS *ecs, Entity e, Component id, void *data) {
   assert(e < MaxEntities && "Invalid entity");
   assert(id < 64 && "Invalid component");
   assert(e < ecs->entity_count && "Entity does not exist");
   assert(id < ecs->comp_count && "Component does not exist");
 
+  // tags only live in the signature
   size_t size = ecs->components[id].size;
-  Component alloc = MemPushBack((void **)&ecs->components[id].list,
-                                   ecs->components[id].alloc, e, data, size);
-  ecs->components[id].alloc = alloc;
+  if (size > 0) {
+    size_t old = ecs->components[id].alloc;
+    size_t alloc = MemPushBack((void **)&ecs->components[id].list,
+                               ecs->components[id].alloc, e, data, size);
+    // slots of entities without the component stay zeroed
+    uint8_t *list = ecs->components[id].list;
+    if (alloc > old && e > old)
+      memset(list + (size_t)old * size, 0, (size_t)(e - old) * size);
+    if (alloc > old && alloc > (size_t)e + 1)
+      memset(list + ((size_t)e + 1) * size, 0, (size_t)(alloc - e - 1) * size);
+    ecs->components[id].alloc = alloc;
+    if (ComponentVersions(&ecs->components[id]))
+      EcsStamp(ecs, e, &ecs->components[id].versions[e]);
+  }
+  Signature signature = ecs->entities[e].signature;
   ecs->entities[e].signature |= (1ULL << id);
+  if (ecs->entities[e].signature != signature)
+    EcsMatchChanged(ecs, e, 1ULL << id);
 }
 
 void *EcsGetComponent(ECS *ecs, Entity e, Component id) {
-  if (!EcsHasComponent(ecs, e, id))
+  if (!EcsHasComponent(ecs, e, id) || ecs->components[id].size == 0)
     return NULL;
 
   return (uint8_t *)ecs->components[id].list + e * ecs->components[id].size;
 }
 
-void EcsRemoveComponent(ECS *ecs, Entity e, Component id) {
-  if (!EcsHasComponent(ecs, e, id))
-    return;
+void *EcsGetComponentMut(ECS *ecs, Entity e, Component id) {
+  void *data = EcsGetComponent(ecs, e, id);
+  if (data && e < ecs->components[id].versioned)
+    EcsStamp(ecs, e, &ecs->components[id].versions[e]);
+  return data;
+}
+
+void EcsMarkChanged(ECS *ecs, Entity e, Component id) {
+  EcsGetComponentMut(ecs, e, id);
+}
 
+static void RemoveComponentData(ECS *ecs, Entity e, Component id) {
   size_t size = ecs->components[id].size;
-  void *dest = (uint8_t *)ecs->components[id].list + e * size;
-  if (ecs->components[id].dtor)
-    ecs->components[id].dtor(dest);
-  memset(dest, 0, size);
+  if (size > 0) {
+    void *dest = (uint8_t *)ecs->components[id].list + e * size;
+    if (ecs->components[id].dtor)
+      ecs->components[id].dtor(dest);
+    memset(dest, 0, size);
+  }
   ecs->entities[e].signature &= ~(1ULL << id);
 }
 
+void EcsRemoveComponent(ECS *ecs, Entity e, Component id) {
+  if (!EcsHasComponent(ecs, e, id))
+    return;
+  RemoveComponentData(ecs, e, id);
+  EcsMatchChanged(ecs, e, 1ULL << id);
+}
+
 bool EcsHasComponent(ECS *ecs, Entity e, Component id) {
   assert(e < MaxEntities && "Invalid entity");
   assert(id < 64 && "Invalid component");
@@ -377,80 +636,277 @@ bool EcsHasComponents(ECS *ecs, Entity e, Signature mask) {
   return (ecs->entities[e].signature & mask) == mask;
 }
 
-Component EcsComponentID(ECS *ecs, char *name) {
-  Component a = 0, b = ecs->comp_count - 1;
-  while (a <= b) {
-    Component k = (a + b) / 2;
-    int c = strcmp(ecs->search[k].name, name);
-    if (c == 0)
-      return ecs->search[k].id;
-
-    if (c > 0)
-      b = k - 1;
-    else
-      a = k + 1;
-  }
-  return InvalidID;
+Component EcsComponentID(ECS *ecs, const char *name) {
+  NameRefs *refs = EcsFindName(ecs, name);
+  return refs ? refs->component : InvalidID;
 }
 
 // ########### //
 //  SIGNATURE  //
 // ########### //
 
-size_t split(char *str, char **out, size_t max) {
-  size_t count = 0;
-  char *tok = strtok(str, ",");
+Signature EcsSignatureImpl(ECS *ecs, const char *const *names, size_t count) {
+  Signature mask = 0;
+  for (size_t i = 0; i < count; i++) {
+    Component cid = EcsComponentID(ecs, names[i]);
+    assert(cid < 64 && "Component not found"); // overflow signature bits
+    mask |= (1ULL << cid);
+  }
+  return mask;
+}
+
+// ######### //
+//  SYSTEMS  //
+// ######### //
 
-  while (tok && count < max) {
-    while (isspace((unsigned char)*tok))
-      tok++;
+static int LowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  int i = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
 
-    char *end = tok + strlen(tok) - 1;
-    while (end > tok && isspace((unsigned char)*end)) {
-      *end-- = '\0';
-    }
+bool EcsQueryMatches(ECS *ecs, Entity e, EcsQuery query) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  Signature signature = ecs->entities[e].signature;
+  return (signature & query.with) == query.with &&
+         (signature & query.without) == 0;
+}
 
-    out[count++] = tok;
-    tok = strtok(NULL, ",");
+// Grows every match bitset to hold entity e.
+static bool EcsMatchReserve(ECS *ecs, Entity e) {
+  size_t words = (size_t)e / 64 + 1;
+  if (words <= ecs->match_words)
+    return true;
+  words = ecs->match_words ? ecs->match_words : 1;
+  while (words * 64 <= e)
+    words *= 2;
+
+  // state bitsets first, then the match bitset of every system
+  uint64_t **state[4] = {&ecs->alive, &ecs->active, &ecs->visible,
+                         &ecs->culled};
+  for (int p = -1; p < EcsTotalPhases; p++) {
+    size_t count = p < 0 ? 4 : ecs->systems[p].size;
+    for (size_t s = 0; s < count; s++) {
+      uint64_t **bits = p < 0 ? state[s] : &ecs->systems[p].list[s].match;
+      uint64_t *grown = realloc(*bits, words * sizeof(uint64_t));
+      if (!grown)
+        return false;
+      memset(grown + ecs->match_words, 0,
+             (words - ecs->match_words) * sizeof(uint64_t));
+      *bits = grown;
+    }
   }
+  // change ticks, per entity then per word
+  uint32_t **ticks[3] = {&ecs->shaped, &ecs->born, &ecs->chunks};
+  for (int t = 0; t < 3; t++) {
+    size_t per = t < 2 ? 64 : 1;
+    uint32_t *grown = realloc(*ticks[t], words * per * sizeof(uint32_t));
+    if (!grown)
+      return false;
+    memset(grown + ecs->match_words * per, 0,
+           (words - ecs->match_words) * per * sizeof(uint32_t));
+    *ticks[t] = grown;
+  }
+  ecs->match_words = words;
+  return true;
+}
 
-  return count;
+// Updates the entity bit of every system after its signature changed.
+static void EcsMatchEntity(ECS *ecs, Entity e, bool alive) {
+  if (!EcsMatchReserve(ecs, e))
+    return;
+  EcsStamp(ecs, e, &ecs->shaped[e]);
+  uint64_t bit = 1ULL << (e % 64);
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    for (EcsID s = 0; s < ecs->systems[p].size; s++) {
+      System *sys = &ecs->systems[p].list[s];
+      if (alive && EcsQueryMatches(ecs, e, sys->query))
+        sys->match[e / 64] |= bit;
+      else
+        sys->match[e / 64] &= ~bit;
+    }
+  }
 }
 
-Signature EcsSignatureImpl(ECS *ecs, const char *str) {
-  Signature mask = 0;
+// Rebuilds the match bitset of every system from scratch, one system at a
+// time: cheaper than matching entity by entity after a bulk change.
+static void EcsMatchAll(ECS *ecs) {
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    for (EcsID s = 0; s < ecs->systems[p].size && ecs->match_words; s++) {
+      System *sys = &ecs->systems[p].list[s];
+      Signature with = sys->query.with, without = sys->query.without;
+      memset(sys->match, 0, ecs->match_words * sizeof(uint64_t));
+      for (Entity e = 0; e < ecs->entity_count; e++) {
+        Signature signature = ecs->entities[e].signature;
+        if ((signature & with) == with && !(signature & without) &&
+            StateGet(ecs->alive, e))
+          sys->match[e / 64] |= 1ULL << (e % 64);
+      }
+    }
+  }
+}
 
-  char buffer[256];
-  strncpy(buffer, str, sizeof(buffer));
-  buffer[sizeof(buffer) - 1] = '\0';
+// Only the systems filtering by a changed component can gain or lose the
+// entity: optional components never change a match.
+static bool EcsQueryDepends(EcsQuery query, Signature changed) {
+  return ((query.with | query.without) & changed) != 0;
+}
 
-  char *components[8];
-  size_t n = split(buffer, components, 8);
-  for (size_t i = 0; i < n; i++) {
-    Component cid = EcsComponentID(ecs, components[i]);
-    assert(cid < 64 && "Component not found"); // overflow signature bits
-    mask |= (1ULL << cid);
+static void EcsMatchChanged(ECS *ecs, Entity e, Signature changed) {
+  if (!EcsMatchReserve(ecs, e))
+    return;
+  EcsStamp(ecs, e, &ecs->shaped[e]);
+  uint64_t bit = 1ULL << (e % 64);
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    for (EcsID s = 0; s < ecs->systems[p].size; s++) {
+      System *sys = &ecs->systems[p].list[s];
+      if (!EcsQueryDepends(sys->query, changed))
+        continue;
+      if (EcsQueryMatches(ecs, e, sys->query))
+        sys->match[e / 64] |= bit;
+      else
+        sys->match[e / 64] &= ~bit;
+    }
   }
-  return mask;
 }
 
-// ######### //
-//  SYSTEMS  //
-// ######### //
+void EcsSetTagBulk(ECS *ecs, const Entity *entities, size_t count,
+                   Component id, bool set) {
+  assert(id < ecs->comp_count && "Component does not exist");
+  assert(ecs->components[id].size == 0 && "Component is not a tag");
+
+  Signature tag = 1ULL << id;
+  Entity last = 0;
+  for (size_t i = 0; i < count; i++) {
+    Entity e = entities[i];
+    assert(e < ecs->entity_count && "Entity does not exist");
+    if (set)
+      ecs->entities[e].signature |= tag;
+    else
+      ecs->entities[e].signature &= ~tag;
+    if (e > last)
+      last = e;
+  }
+  if (count == 0 || !EcsMatchReserve(ecs, last))
+    return;
+  for (size_t i = 0; i < count; i++)
+    EcsStamp(ecs, entities[i], &ecs->shaped[entities[i]]);
+
+  // one pass per dependent system keeps its bitset hot in cache
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    for (EcsID s = 0; s < ecs->systems[p].size; s++) {
+      System *sys = &ecs->systems[p].list[s];
+      if (!EcsQueryDepends(sys->query, tag))
+        continue;
+      for (size_t i = 0; i < count; i++) {
+        Entity e = entities[i];
+        uint64_t bit = 1ULL << (e % 64);
+        if (EcsQueryMatches(ecs, e, sys->query))
+          sys->match[e / 64] |= bit;
+        else
+          sys->match[e / 64] &= ~bit;
+      }
+    }
+  }
+}
 
-void EcsAddSystem(ECS *ecs, Script s, EcsPhase phase, Signature mask) {
+void EcsAddSystemNamed(ECS *ecs, Script s, const char *name, EcsPhase phase,
+                       EcsQuery query) {
   if (phase >= EcsTotalPhases)
     return;
 
-  System sys = {s, mask};
-  EcsID alloc = MemPushBack((void **)&ecs->systems[phase].list,
-                               ecs->systems[phase].alloc,
-                               ecs->systems[phase].size, &sys, sizeof(System));
-  if (alloc == InvalidID)
+  System sys = {s, query, NULL, name};
+  if (ecs->match_words > 0) {
+    sys.match = calloc(ecs->match_words, sizeof(uint64_t));
+    if (!sys.match)
+      return;
+  }
+  for (Entity e = 0; e < ecs->entity_count; e++)
+    if (StateGet(ecs->alive, e) && EcsQueryMatches(ecs, e, query))
+      sys.match[e / 64] |= 1ULL << (e % 64);
+
+  PhaseSystem *ps = &ecs->systems[phase];
+#if defined(GEARECS_PROFILE)
+  ProfileRing *profile =
+      realloc(ps->profile, (ps->size + 1) * sizeof(ProfileRing));
+  if (!profile) {
+    free(sys.match);
+    return;
+  }
+  memset(&profile[ps->size], 0, sizeof(ProfileRing));
+  ps->profile = profile;
+#endif
+  EcsID alloc = MemPushBack((void **)&ps->list, ps->alloc, ps->size, &sys,
+                            sizeof(System));
+  if (alloc == 0) {
+    free(sys.match);
     return;
+  }
 
-  ecs->systems[phase].alloc = alloc;
-  ecs->systems[phase].size++;
+  ps->alloc = alloc;
+  ps->size++;
+}
+
+void EcsAddSystemQuery(ECS *ecs, Script s, EcsPhase phase, EcsQuery query) {
+  EcsAddSystemNamed(ecs, s, NULL, phase, query);
+}
+
+void EcsAddSystem(ECS *ecs, Script s, EcsPhase phase, Signature mask) {
+  EcsAddSystemNamed(ecs, s, NULL, phase, (EcsQuery){mask, 0, 0});
+}
+
+EcsID EcsSystemCount(ECS *ecs, EcsPhase phase) {
+  return phase < EcsTotalPhases ? ecs->systems[phase].size : 0;
+}
+
+static const char *PhaseNames[EcsTotalPhases] = {
+    "Start", "Update", "LateUpdate", "FixedUpdate", "PreRender", "Render",
+    "Gui"};
+
+#if defined(GEARECS_PROFILE)
+static int BitCount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(bits);
+#else
+  int n = 0;
+  for (; bits; bits &= bits - 1)
+    n++;
+  return n;
+#endif
+}
+
+static ProfileSample *ProfileCurrent(ECS *ecs, ProfileSample *ring) {
+  return &ring[ecs->profile_frame % (ProfileWindow + 1)];
+}
+
+static void ProfileRecord(ECS *ecs, ProfileSample *ring, double start,
+                          uint32_t visited, uint32_t matched) {
+  ProfileSample *sample = ProfileCurrent(ecs, ring);
+  sample->time += ClockWallTime() - start;
+  sample->calls++;
+  sample->visited += visited;
+  sample->matched += matched;
+}
+
+#define ProfileStart() ClockWallTime()
+#define ProfileCount(n) (n)
+#else
+#define ProfileStart() 0.0
+#define ProfileCount(n) 0
+#define ProfileRecord(ecs, ring, start, visited, matched)                      \
+  ((void)(start), (void)(visited), (void)(matched))
+#endif
+
+static const char *SystemName(System *s) {
+  return s->name ? s->name : "System";
 }
 
 void EcsRunSystems(ECS *ecs, EcsPhase phase) {
@@ -458,121 +914,1587 @@ void EcsRunSystems(ECS *ecs, EcsPhase phase) {
   System *list = ecs->systems[phase].list;
   if (!list)
     return;
+  double phase_start = ProfileStart();
+  double phase_trace = TraceBegin(ecs->trace);
+  uint32_t phase_visited = 0, phase_matched = 0;
 
-  // for update systems
+  // for update systems, only the matching active entities are visited
   if (ecs->layer_count == 0 || phase < EcsOnRender) {
     for (size_t s = 0; s < len; s++) {
-      for (Entity e = 0; e < ecs->entity_count; e++) {
-        if (EcsHasComponents(ecs, e, list[s].mask) && EntityIsActive(ecs, e))
-          list[s].run(ecs, e);
+      double start = ProfileStart();
+      double trace = TraceBegin(ecs->trace);
+      uint32_t visited = 0, matched = 0;
+      // scripts may change the bits or add entities while iterating
+      for (size_t w = 0; w < ecs->match_words; w++) {
+        uint64_t bits = list[s].match[w] & ecs->active[w];
+        visited += ProfileCount(BitCount(list[s].match[w]));
+        while (bits) {
+          int i = LowestBit(bits);
+          list[s].run(ecs, (Entity)(w * 64 + i));
+          matched += ProfileCount(1);
+          bits = list[s].match[w] & ecs->active[w];
+          bits = i < 63 ? bits & ~((2ULL << i) - 1) : 0;
+        }
       }
+      ProfileRecord(ecs, ecs->systems[phase].profile[s], start, visited,
+                    matched);
+      TraceEnd(ecs->trace, SystemName(&list[s]), "system", trace);
+      phase_visited += visited;
+      phase_matched += matched;
     }
+    ProfileRecord(ecs, ecs->systems[phase].total, phase_start, phase_visited,
+                  phase_matched);
+    TraceEnd(ecs->trace, PhaseNames[phase], "phase", phase_trace);
     return;
   }
 
-  // for rendering systems
+  for (Layer l = 0; l < ecs->layer_count; l++)
+    if (ecs->render[l].dirty)
+      LayerSort(ecs, &ecs->render[l]);
+
+  // for rendering systems, culling only applies to world space
+  bool cull = phase == EcsOnRender;
   for (size_t s = 0; s < len; s++) {
-    for (uint8_t l = 0; l < ecs->layer_count; l++) {
+    double start = ProfileStart();
+    double trace = TraceBegin(ecs->trace);
+    uint32_t visited = 0, matched = 0;
+    for (Layer l = 0; l < ecs->layer_count; l++) {
+      visited += ProfileCount(ecs->render[l].count - ecs->render[l].holes);
       for (Entity i = 0; i < ecs->render[l].count; i++) {
-        Entity e = ecs->render[l].entities[i];
-        if (EcsHasComponents(ecs, e, list[s].mask) && EntityIsVisible(ecs, e))
+        Entity e = ecs->render[l].entries[i].entity;
+        if (e == InvalidID)
+          continue;
+        uint64_t bits = list[s].match[e / 64] & ecs->visible[e / 64];
+        if (cull)
+          bits &= ~ecs->culled[e / 64];
+        if (bits >> (e % 64) & 1) {
           list[s].run(ecs, e);
+          matched += ProfileCount(1);
+        }
       }
     }
+    ProfileRecord(ecs, ecs->systems[phase].profile[s], start, visited,
+                  matched);
+    TraceEnd(ecs->trace, SystemName(&list[s]), "system", trace);
+    phase_visited += visited;
+    phase_matched += matched;
+  }
+  ProfileRecord(ecs, ecs->systems[phase].total, phase_start, phase_visited,
+                phase_matched);
+  TraceEnd(ecs->trace, PhaseNames[phase], "phase", phase_trace);
+}
+
+void EcsSetFixedDelta(ECS *ecs, float dt) {
+  if (dt > 0)
+    ecs->fixed_delta = dt;
+}
+
+float EcsFixedDelta(ECS *ecs) { return ecs->fixed_delta; }
+
+// ###### //
+//  TAGS  //
+// ###### //
+
+TagID TagFind(ECS *ecs, const char *tag) {
+  NameRefs *refs = tag ? EcsFindName(ecs, tag) : NULL;
+  return refs ? refs->tag : InvalidID;
+}
+
+TagID TagIntern(ECS *ecs, const char *tag) {
+  NameRefs *refs = tag ? EcsName(ecs, tag) : NULL;
+  if (!refs)
+    return InvalidID;
+  if (refs->tag != InvalidID)
+    return refs->tag;
+  if (ecs->tag_count >= InvalidID - 1)
+    return InvalidID;
+
+  TagInfo info = {EcsNameString(ecs, refs), NULL, 0, 0};
+  ecs->tag_alloc = MemPushBack((void **)&ecs->tags, ecs->tag_alloc,
+                               ecs->tag_count, &info, sizeof(TagInfo));
+  refs->tag = ecs->tag_count;
+  return ecs->tag_count++;
+}
+
+const char *TagName(ECS *ecs, TagID tag) {
+  return tag < ecs->tag_count ? ecs->tags[tag].name : NULL;
+}
+
+static void AddEntityToTagID(ECS *ecs, Entity e, TagID id) {
+  if (id == InvalidID)
+    return;
+  if (e >= ecs->tag_slot_alloc) {
+    ecs->tag_slot_alloc = MemEnsureCapacity(
+        (void **)&ecs->tag_slots, ecs->tag_slot_alloc, e + 1, sizeof(Entity));
+    if (!ecs->tag_slot_alloc)
+      return;
   }
+
+  TagInfo *info = &ecs->tags[id];
+  ecs->tag_slots[e] = info->count;
+  info->alloc = MemPushBack((void **)&info->entities, info->alloc,
+                            info->count++, &e, sizeof(Entity));
+  ecs->entities[e].tag = info->name;
+  ecs->entities[e].tag_id = id;
+}
+
+static void AddEntityToTag(ECS *ecs, Entity e, const char *tag) {
+  AddEntityToTagID(ecs, e, TagIntern(ecs, tag));
+}
+
+static void RemoveEntityFromTag(ECS *ecs, Entity e) {
+  TagID id = ecs->entities[e].tag_id;
+  if (id >= ecs->tag_count)
+    return;
+  TagInfo *info = &ecs->tags[id];
+  Entity slot = ecs->tag_slots[e];
+  Entity last = info->entities[--info->count];
+  info->entities[slot] = last;
+  ecs->tag_slots[last] = slot;
+  ecs->entities[e].tag = NULL;
+  ecs->entities[e].tag_id = InvalidID;
+}
+
+void EntitySetTag(ECS *ecs, Entity e, const char *tag) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  RemoveEntityFromTag(ecs, e);
+  AddEntityToTag(ecs, e, tag);
+}
+
+Entity EntityFindByTag(ECS *ecs, const char *tag) {
+  TagID id = TagFind(ecs, tag);
+  if (id == InvalidID || ecs->tags[id].count == 0)
+    return InvalidID;
+  return ecs->tags[id].entities[0];
+}
+
+const Entity *EntityFindAllByTag(ECS *ecs, const char *tag, Entity *count) {
+  TagID id = TagFind(ecs, tag);
+  *count = id == InvalidID ? 0 : ecs->tags[id].count;
+  return *count ? ecs->tags[id].entities : NULL;
+}
+
+bool EntityHasTag(ECS *ecs, Entity e, const char *tag) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  TagID id = ecs->entities[e].tag_id;
+  return id != InvalidID && id == TagFind(ecs, tag);
+}
+
+bool EntityHasTagID(ECS *ecs, Entity e, TagID tag) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  return tag != InvalidID && ecs->entities[e].tag_id == tag;
 }
 
 // ######## //
 //  LAYERS  //
 // ######## //
 
-uint8_t LayerIndex(ECS *ecs, char *name) {
-  for (int i = 0; i < ecs->layer_count; i++)
-    if (strcmp(ecs->layers[i].name, name) == 0)
-      return i;
-  assert(!"Layer does not exist!");
-  return ecs->layer_count;
+Layer LayerFind(ECS *ecs, const char *name) {
+  NameRefs *refs = EcsFindName(ecs, name);
+  return refs ? refs->layer : InvalidLayer;
+}
+
+const char *LayerName(ECS *ecs, Layer layer) {
+  assert(layer < ecs->layer_count && "Layer does not exist!");
+  return ecs->layers[layer].name;
 }
 
-void AddLayer(ECS *ecs, char *name) {
+Layer AddLayer(ECS *ecs, const char *name) {
+  NameRefs *refs = EcsName(ecs, name);
+  if (!refs)
+    return InvalidLayer;
+  if (refs->layer != InvalidLayer)
+    return refs->layer;
+  assert(ecs->layer_count < MaxLayers && "Exceeded maximum number of layers");
+  if (ecs->layer_count >= MaxLayers)
+    return InvalidLayer;
+
   EcsID count = ecs->layer_count;
   EcsID alloc = ecs->layer_alloc;
 
-  Layer ly = {name, (Signature)-1}; // all enabled
-  MemPushBack((void **)&ecs->layers, alloc, count, &ly, sizeof(Layer));
+  LayerInfo ly = {EcsNameString(ecs, refs)};
+  MemPushBack((void **)&ecs->layers, alloc, count, &ly, sizeof(LayerInfo));
 
-  LayerEntities le = {NULL, 0, 0};
+  LayerEntities le = {NULL, 0, 0, 0, false};
   alloc = MemPushBack((void **)&ecs->render, alloc, count, &le,
-                         sizeof(LayerEntities));
+                      sizeof(LayerEntities));
 
   ecs->layer_count++;
   ecs->layer_alloc = alloc;
+  refs->layer = (Layer)count;
+  return (Layer)count;
 }
 
-void EcsFreeLayers(ECS *ecs) {
-  if (ecs->layers)
-    free(ecs->layers);
-  ecs->layers = NULL;
-  ecs->layer_count = 0;
+void EntitySetLayer(ECS *ecs, Entity e, Layer layer) {
+  assert(layer < ecs->layer_count && "Layer does not exist!");
+  if (layer >= ecs->layer_count)
+    return;
+  // an entity may be missing from the entries of its own layer (created
+  // before the layer list, or restored without its slot)
+  bool listed = e < ecs->slot_alloc && ecs->slots[e].slot != InvalidID;
+  if (ecs->entities[e].layer == layer && listed)
+    return;
+  RemoveEntityFromLayer(ecs, e);
+  ecs->entities[e].layer = layer;
+  AddEntityToLayer(ecs, e, layer);
 }
 
-void EntitySetLayer(ECS *ecs, Entity e, char *layer) {
-  RemoveEntityFromLayer(ecs, e);
-  uint8_t ly = LayerIndex(ecs, layer);
-  ecs->entities[e].layer = ly;
-  AddEntityToLayer(ecs, e, ly);
+// Grows the index map up to e, new entities aren't in any layer.
+static RenderSlot *EntitySlot(ECS *ecs, Entity e) {
+  if (e >= ecs->slot_alloc) {
+    Entity alloc = ecs->slot_alloc ? ecs->slot_alloc : 64;
+    while (alloc <= e && alloc < MaxEntities)
+      alloc = alloc * 2 < MaxEntities ? alloc * 2 : MaxEntities;
+    RenderSlot *slots = realloc(ecs->slots, alloc * sizeof(RenderSlot));
+    if (!slots)
+      return NULL;
+    for (Entity i = ecs->slot_alloc; i < alloc; i++)
+      slots[i] = (RenderSlot){InvalidID, 0, 0};
+    ecs->slots = slots;
+    ecs->slot_alloc = alloc;
+  }
+  return &ecs->slots[e];
 }
 
-void AddEntityToLayer(ECS *ecs, Entity e, uint8_t ly) {
+void AddEntityToLayer(ECS *ecs, Entity e, Layer ly) {
   if (!ecs->render || ecs->layer_count <= ly)
     return;
+  RenderSlot *slot = EntitySlot(ecs, e);
+  if (!slot)
+    return;
 
-  EcsID count = ecs->render[ly].count;
-  EcsID alloc = ecs->render[ly].alloc;
-
-  alloc = MemPushBack((void **)&ecs->render[ly].entities, alloc, count, &e,
-                         sizeof(Entity));
+  LayerEntities *le = &ecs->render[ly];
+  LayerEntry entry = {e, slot->key};
+  slot->rank = 0;
+  if (le->count > 0) {
+    LayerEntry *last = &le->entries[le->count - 1];
+    if (last->entity == InvalidID || last->key != entry.key)
+      le->dirty = true;
+    else
+      slot->rank = ecs->slots[last->entity].rank;
+  }
 
-  ecs->render[ly].count++;
-  ecs->render[ly].alloc = alloc;
+  le->alloc = MemPushBack((void **)&le->entries, le->alloc, le->count, &entry,
+                          sizeof(LayerEntry));
+  slot->slot = le->count++;
 }
 
+// Entries are only marked: the order of the layer doesn't change.
 void RemoveEntityFromLayer(ECS *ecs, Entity e) {
-  uint8_t ly = ecs->entities[e].layer;
-  if (!ecs->render || ecs->layer_count <= ly || !ecs->render[ly].entities)
+  Layer ly = ecs->entities[e].layer;
+  if (!ecs->render || ecs->layer_count <= ly || e >= ecs->slot_alloc ||
+      ecs->slots[e].slot == InvalidID)
     return;
-  Entity last = ecs->render[ly].count - 1;
-  for (int i = (int)last; i >= 0; i--) {
-    if (ecs->render[ly].entities[i] == e) {
-      ecs->render[ly].entities[i] = ecs->render[ly].entities[last];
-      ecs->render[ly].count--;
-      return;
-    }
+
+  LayerEntities *le = &ecs->render[ly];
+  if (ecs->slots[e].slot == le->count - 1) {
+    le->count--;
+  } else {
+    le->entries[ecs->slots[e].slot].entity = InvalidID;
+    le->holes++;
+    le->dirty = true;
   }
+  ecs->slots[e].slot = InvalidID;
 }
 
-void LayerEnable(ECS *ecs, char *layer1, char *layer2) {
-  uint8_t ly1 = LayerIndex(ecs, layer1);
-  uint8_t ly2 = LayerIndex(ecs, layer2);
-  ecs->layers[ly1].mask |= (1ULL << ly2);
-  ecs->layers[ly2].mask |= (1ULL << ly1);
+// Compacts the removed entries, then sorts by key. Keys change a little
+// between frames, so insertion sort runs on nearly sorted data and keeps the
+// insertion order of equal keys.
+static void LayerSort(ECS *ecs, LayerEntities *le) {
+  Entity count = 0;
+  for (Entity i = 0; i < le->count; i++)
+    if (le->entries[i].entity != InvalidID)
+      le->entries[count++] = le->entries[i];
+  le->count = count;
+  le->holes = 0;
+
+  for (Entity i = 1; i < count; i++) {
+    LayerEntry entry = le->entries[i];
+    Entity j = i;
+    for (; j > 0 && le->entries[j - 1].key > entry.key; j--)
+      le->entries[j] = le->entries[j - 1];
+    le->entries[j] = entry;
+  }
+
+  uint16_t rank = 0;
+  for (Entity i = 0; i < count; i++) {
+    if (i > 0 && le->entries[i].key != le->entries[i - 1].key)
+      rank++;
+    RenderSlot *slot = &ecs->slots[le->entries[i].entity];
+    slot->slot = i;
+    slot->rank = rank;
+  }
+  le->dirty = false;
+}
+
+void EntitySetSortKey(ECS *ecs, Entity e, float key) {
+  assert(e < MaxEntities && "Invalid entity");
+  assert(e < ecs->entity_count && "Entity does not exist");
+  RenderSlot *slot = EntitySlot(ecs, e);
+  if (!slot || slot->key == key)
+    return;
+  slot->key = key;
+  if (slot->slot == InvalidID)
+    return;
+  LayerEntities *le = &ecs->render[ecs->entities[e].layer];
+  le->entries[slot->slot].key = key;
+  le->dirty = true;
 }
 
-void LayerDisable(ECS *ecs, char *layer1, char *layer2) {
-  uint8_t ly1 = LayerIndex(ecs, layer1);
-  uint8_t ly2 = LayerIndex(ecs, layer2);
-  ecs->layers[ly1].mask &= ~(1ULL << ly2);
-  ecs->layers[ly2].mask &= ~(1ULL << ly1);
+float EntityGetSortKey(ECS *ecs, Entity e) {
+  assert(e < MaxEntities && "Invalid entity");
+  return e < ecs->slot_alloc ? ecs->slots[e].key : 0;
 }
 
-void LayerDisableAll(ECS *ecs, char *layer) {
-  uint8_t ly = LayerIndex(ecs, layer);
-  ecs->layers[ly].mask = 0;
+uint16_t EntitySortRank(ECS *ecs, Entity e) {
+  assert(e < MaxEntities && "Invalid entity");
+  return e < ecs->slot_alloc ? ecs->slots[e].rank : 0;
 }
 
-bool LayerIncludes(ECS *ecs, uint8_t layer1, uint8_t layer2) {
-  if (ecs->layer_count == 0)
-    return true;
-  Signature mask = (1 << layer2);
-  return (ecs->layers[layer1].mask & mask) == mask;
+EcsID EntitySortIndex(ECS *ecs, Entity e) {
+  assert(e < MaxEntities && "Invalid entity");
+  return e < ecs->slot_alloc ? ecs->slots[e].slot : InvalidID;
+}
+
+void LayerEnable(ECS *ecs, Layer layer1, Layer layer2) {
+  assert(layer1 < MaxLayers && layer2 < MaxLayers && "Invalid layer");
+  ecs->collide[layer1] |= (1ULL << layer2);
+  ecs->collide[layer2] |= (1ULL << layer1);
+}
+
+void LayerDisable(ECS *ecs, Layer layer1, Layer layer2) {
+  assert(layer1 < MaxLayers && layer2 < MaxLayers && "Invalid layer");
+  ecs->collide[layer1] &= ~(1ULL << layer2);
+  ecs->collide[layer2] &= ~(1ULL << layer1);
+}
+
+void LayerDisableAll(ECS *ecs, Layer layer) {
+  assert(layer < MaxLayers && "Invalid layer");
+  ecs->collide[layer] = 0;
+  for (Layer i = 0; i < MaxLayers; i++)
+    ecs->collide[i] &= ~(1ULL << layer);
+}
+
+bool LayerIncludes(ECS *ecs, Layer layer1, Layer layer2) {
+  return LayerMatrixIncludes(ecs->collide, layer1, layer2);
+}
+
+const Signature *LayerMatrix(ECS *ecs) { return ecs->collide; }
+
+// ########## //
+//  SNAPSHOT  //
+// ########## //
+
+#define SNAPSHOT_MAGIC 0x53434547u  // "GECS"
+#define SNAPSHOT_ENDIAN 0x01020304u // byte order check
+#define SNAPSHOT_ALIGN 8            // alignment of the column blocks
+
+void EcsComponentSerialize(ECS *ecs, Component id, ComponentSave save,
+                           ComponentLoad load) {
+  assert(id < ecs->comp_count && "Component does not exist");
+  ecs->components[id].save = save;
+  ecs->components[id].load = load;
+  ecs->components[id].hooked = true;
+}
+
+// Components owning memory can't be copied without hooks.
+static bool ComponentSaved(ComponentData *c) { return !c->dtor || c->hooked; }
+
+static void WriteU32(Stream *out, uint32_t value) {
+  StreamWrite(out, &value, sizeof(uint32_t));
 }
+
+static uint32_t ReadU32(Stream *in) {
+  uint32_t value;
+  StreamRead(in, &value, sizeof(uint32_t));
+  return value;
+}
+
+static void WriteName(Stream *out, const char *name) {
+  uint16_t len = (uint16_t)strlen(name);
+  StreamWrite(out, &len, sizeof(uint16_t));
+  StreamWrite(out, name, len);
+}
+
+// Interns a name read from a snapshot.
+static const char *ReadName(ECS *ecs, Stream *in) {
+  uint16_t len;
+  StreamRead(in, &len, sizeof(uint16_t));
+  const char *str = StreamView(in, len);
+  if (!str || !ecs)
+    return NULL;
+  return StringGet(&ecs->names, StringInternN(&ecs->names, str, len));
+}
+
+static void SkipName(Stream *in) {
+  uint16_t len;
+  StreamRead(in, &len, sizeof(uint16_t));
+  StreamView(in, len);
+}
+
+bool EcsSnapshot(ECS *ecs, Stream *out) {
+  Entity n = ecs->entity_count;
+  size_t words = ((size_t)n + 63) / 64;
+
+  WriteU32(out, SNAPSHOT_MAGIC);
+  WriteU32(out, SnapshotVersion);
+  WriteU32(out, SNAPSHOT_ENDIAN);
+
+  WriteU32(out, ecs->comp_count);
+  for (Component i = 0; i < ecs->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    WriteName(out, c->name);
+    WriteU32(out, (uint32_t)c->size);
+    WriteU32(out, ComponentSaved(c));
+  }
+  WriteU32(out, ecs->layer_count);
+  for (Layer l = 0; l < ecs->layer_count; l++)
+    WriteName(out, ecs->layers[l].name);
+  WriteU32(out, ecs->tag_count);
+  for (TagID t = 0; t < ecs->tag_count; t++)
+    WriteName(out, ecs->tags[t].name);
+
+  // entity columns, largest types first to keep them aligned
+  WriteU32(out, n);
+  WriteU32(out, ecs->free_count);
+  StreamPad(out, SNAPSHOT_ALIGN);
+  StreamWrite(out, ecs->collide, ecs->layer_count * sizeof(Signature));
+  for (Entity e = 0; e < n; e++)
+    StreamWrite(out, &ecs->entities[e].signature, sizeof(Signature));
+  uint64_t *bits[4] = {ecs->alive, ecs->active, ecs->visible, ecs->culled};
+  for (int b = 0; b < 4; b++)
+    StreamWrite(out, bits[b], words * sizeof(uint64_t));
+  for (Entity e = 0; e < n; e++) {
+    float key = e < ecs->slot_alloc ? ecs->slots[e].key : 0;
+    StreamWrite(out, &key, sizeof(float));
+  }
+  for (Entity e = 0; e < n; e++)
+    StreamWrite(out, &ecs->entities[e].tag_id, sizeof(TagID));
+  StreamWrite(out, ecs->free_entities, ecs->free_count * sizeof(Entity));
+  for (Entity e = 0; e < n; e++)
+    StreamWrite(out, &ecs->entities[e].layer, sizeof(Layer));
+
+  // render order of each layer, without the removed entries
+  for (Layer l = 0; l < ecs->layer_count; l++) {
+    LayerEntities *le = &ecs->render[l];
+    StreamPad(out, SNAPSHOT_ALIGN);
+    WriteU32(out, le->count - le->holes);
+    for (Entity i = 0; i < le->count; i++)
+      if (le->entries[i].entity != InvalidID)
+        StreamWrite(out, &le->entries[i].entity, sizeof(Entity));
+  }
+
+  // component columns: raw block up to the last entity owning the component,
+  // then the hook data prefixed by its size
+  for (Component i = 0; i < ecs->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    if (!ComponentSaved(c))
+      continue;
+    Signature bit = 1ULL << i;
+    Entity rows = n;
+    while (rows > 0 && !(ecs->entities[rows - 1].signature & bit))
+      rows--;
+    WriteU32(out, c->size ? rows : 0);
+    StreamPad(out, SNAPSHOT_ALIGN);
+    if (c->size)
+      StreamWrite(out, c->list, (size_t)rows * c->size);
+
+    StreamPad(out, SNAPSHOT_ALIGN);
+    size_t at = out->size;
+    WriteU32(out, 0);
+    for (Entity e = 0; c->save && e < n; e++)
+      if (ecs->entities[e].signature & bit)
+        c->save((uint8_t *)c->list + (size_t)e * c->size, out);
+    if (!out->failed) {
+      uint32_t extra = (uint32_t)(out->size - at - sizeof(uint32_t));
+      memcpy(out->data + at, &extra, sizeof(uint32_t));
+    }
+  }
+  return !out->failed;
+}
+
+typedef struct {
+  uint32_t comp_count;
+  Component map[64];  // Snapshot component -> registry component
+  uint32_t size[64];  // Snapshot component size
+  bool saved[64];     // Whether the snapshot has the column
+  uint32_t rows[64];  // Rows of the column
+  uint32_t layer_count;
+  size_t layer_names; // Stream position of the layer names
+  uint32_t tag_count;
+  size_t tag_names;   // Stream position of the tag names
+  Entity count;
+  Entity free_count;
+  const Signature *collide;
+  const Signature *signatures;
+  const uint64_t *bits[4]; // Alive, active, visible, culled
+  const float *keys;
+  const TagID *tag_ids;
+  const Entity *free_list;
+  const Layer *layers;
+  size_t entries; // Stream position of the layer entries
+} Snapshot;
+
+// Reads the tables and views the entity columns. The rest is skimmed, so
+// nothing is changed unless the whole snapshot fits.
+static bool SnapshotParse(ECS *ecs, Stream *in, Snapshot *snap) {
+  if (ReadU32(in) != SNAPSHOT_MAGIC || ReadU32(in) != SnapshotVersion ||
+      ReadU32(in) != SNAPSHOT_ENDIAN)
+    return false;
+
+  snap->comp_count = ReadU32(in);
+  if (snap->comp_count > 64)
+    return false;
+  for (uint32_t i = 0; i < snap->comp_count; i++) {
+    uint16_t len;
+    StreamRead(in, &len, sizeof(uint16_t));
+    const char *name = StreamView(in, len);
+    snap->size[i] = ReadU32(in);
+    snap->saved[i] = ReadU32(in) != 0;
+    snap->map[i] = InvalidID;
+    snap->rows[i] = 0;
+    if (!name)
+      return false;
+
+    StringID str = StringFindN(&ecs->names, name, len);
+    Component id = str < ecs->ref_alloc ? ecs->refs[str].component : InvalidID;
+    if (id == InvalidID || !snap->saved[i] ||
+        !ComponentSaved(&ecs->components[id]))
+      continue;
+    if (ecs->components[id].size != snap->size[i])
+      return false; // the component layout changed
+    snap->map[i] = id;
+  }
+
+  snap->layer_count = ReadU32(in);
+  snap->layer_names = in->pos;
+  for (uint32_t l = 0; l < snap->layer_count; l++)
+    SkipName(in);
+  snap->tag_count = ReadU32(in);
+  snap->tag_names = in->pos;
+  for (uint32_t t = 0; t < snap->tag_count; t++)
+    SkipName(in);
+
+  uint32_t count = ReadU32(in), free_count = ReadU32(in);
+  if (snap->layer_count > MaxLayers || count > MaxEntities ||
+      free_count > count)
+    return false;
+  snap->count = (Entity)count;
+  snap->free_count = (Entity)free_count;
+  size_t words = ((size_t)count + 63) / 64;
+  StreamAlign(in, SNAPSHOT_ALIGN);
+  snap->collide = StreamView(in, snap->layer_count * sizeof(Signature));
+  snap->signatures = StreamView(in, count * sizeof(Signature));
+  for (int b = 0; b < 4; b++)
+    snap->bits[b] = StreamView(in, words * sizeof(uint64_t));
+  snap->keys = StreamView(in, count * sizeof(float));
+  snap->tag_ids = StreamView(in, count * sizeof(TagID));
+  snap->free_list = StreamView(in, free_count * sizeof(Entity));
+  snap->layers = StreamView(in, count * sizeof(Layer));
+
+  snap->entries = in->pos;
+  for (uint32_t l = 0; l < snap->layer_count; l++) {
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    uint32_t entries = ReadU32(in);
+    if (entries > count)
+      return false;
+    StreamView(in, entries * sizeof(Entity));
+  }
+  for (uint32_t i = 0; i < snap->comp_count; i++) {
+    if (!snap->saved[i])
+      continue;
+    uint32_t rows = snap->rows[i] = ReadU32(in);
+    if (rows > count)
+      return false;
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    StreamView(in, (size_t)snap->size[i] * rows);
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    StreamView(in, ReadU32(in));
+  }
+  return !in->failed;
+}
+
+static Signature SnapshotSignature(Snapshot *snap, Signature saved) {
+  Signature signature = 0;
+  for (; saved; saved &= saved - 1) {
+    int i = LowestBit(saved);
+    if (i < (int)snap->comp_count && snap->map[i] != InvalidID)
+      signature |= 1ULL << snap->map[i];
+  }
+  return signature;
+}
+
+// Creates the missing layers and copies the collision matrix.
+static void RestoreLayers(ECS *ecs, Stream *in, Snapshot *snap,
+                          Layer *layers) {
+  in->pos = snap->layer_names;
+  for (uint32_t l = 0; l < snap->layer_count; l++) {
+    layers[l] = AddLayer(ecs, ReadName(ecs, in));
+    if (layers[l] == InvalidLayer)
+      layers[l] = 0;
+  }
+  for (uint32_t l = 0; l < snap->layer_count; l++) {
+    Signature row = 0;
+    for (uint32_t k = 0; k < snap->layer_count; k++)
+      if (LayerMatrixIncludes(snap->collide, l, k))
+        row |= 1ULL << layers[k];
+    ecs->collide[layers[l]] = row;
+  }
+}
+
+// Grows every table and column the snapshot fills, as FramePrepare() does, so
+// that nothing can fail once the entities are freed.
+static bool RestoreReserve(ECS *ecs, Snapshot *snap) {
+  Entity n = snap->count;
+  if (n == 0)
+    return true;
+  size_t alloc = MemEnsureCapacity((void **)&ecs->entities, ecs->entity_alloc,
+                                   n, sizeof(EntityData));
+  if (!alloc)
+    return false;
+  ecs->entity_alloc = alloc;
+  if (snap->free_count > 0) {
+    alloc = MemEnsureCapacity((void **)&ecs->free_entities, ecs->free_alloc,
+                              snap->free_count, sizeof(Entity));
+    if (!alloc)
+      return false;
+    ecs->free_alloc = alloc;
+  }
+  if (!EcsMatchReserve(ecs, n - 1) || !EntitySlot(ecs, n - 1))
+    return false;
+
+  for (uint32_t i = 0; i < snap->comp_count; i++) {
+    Component id = snap->map[i];
+    if (id == InvalidID)
+      continue;
+    ComponentData *c = &ecs->components[id];
+    if (c->size == 0 || snap->rows[i] <= c->alloc)
+      continue;
+    alloc = MemEnsureCapacity(&c->list, c->alloc, snap->rows[i], c->size);
+    if (!alloc)
+      return false;
+    c->alloc = alloc;
+  }
+  return true;
+}
+
+// Frees every entity, keeping the allocations for the restored ones. Only
+// the destructors run per entity: the tables are reset as a whole.
+static void RestoreClear(ECS *ecs) {
+  for (Component id = 0; id < ecs->comp_count; id++) {
+    ComponentData *c = &ecs->components[id];
+    Signature bit = 1ULL << id;
+    for (Entity e = 0; c->dtor && e < c->alloc && e < ecs->entity_count; e++)
+      if (ecs->entities[e].signature & bit)
+        c->dtor((uint8_t *)c->list + (size_t)e * c->size);
+    if (c->size > 0 && c->alloc > 0)
+      memset(c->list, 0, c->alloc * c->size);
+  }
+  for (Entity e = 0; e < ecs->entity_count; e++) {
+    ecs->entities[e] = (EntityData){0};
+    ecs->entities[e].tag_id = InvalidID;
+    if (e < ecs->slot_alloc)
+      ecs->slots[e].key = 0;
+  }
+  for (TagID t = 0; t < ecs->tag_count; t++)
+    ecs->tags[t].count = 0;
+  for (Layer l = 0; l < ecs->layer_count; l++) {
+    ecs->render[l].count = 0;
+    ecs->render[l].holes = 0;
+  }
+  ecs->entity_count = 0;
+  ecs->free_count = 0;
+}
+
+// Columns were grown by RestoreReserve().
+static void RestoreColumns(ECS *ecs, Stream *in, Snapshot *snap) {
+  Entity n = snap->count;
+  for (uint32_t i = 0; i < snap->comp_count; i++) {
+    if (!snap->saved[i])
+      continue;
+    uint32_t rows = ReadU32(in);
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    const uint8_t *column = StreamView(in, (size_t)snap->size[i] * rows);
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    uint32_t extra = ReadU32(in);
+    Stream hooks = StreamReader(StreamView(in, extra), extra);
+    Component id = snap->map[i];
+    if (id == InvalidID)
+      continue;
+
+    ComponentData *c = &ecs->components[id];
+    if (c->size > 0 && rows > 0)
+      memcpy(c->list, column, c->size * rows);
+    if (c->size > 0 && c->alloc > rows)
+      memset((uint8_t *)c->list + c->size * rows, 0,
+             c->size * (c->alloc - rows));
+    Signature bit = 1ULL << id;
+    for (Entity e = rows; c->size > 0 && e < n; e++)
+      ecs->entities[e].signature &= ~bit; // no data past the column
+    for (Entity e = 0; c->load && e < n; e++)
+      if (ecs->entities[e].signature & bit)
+        c->load((uint8_t *)c->list + (size_t)e * c->size, &hooks);
+    if (c->size == 0 || !ComponentVersions(c) || !c->versioned)
+      continue;
+    memset(c->versions, 0, c->versioned * sizeof(uint32_t));
+    for (Entity e = 0; e < rows; e++)
+      if (ecs->entities[e].signature & bit)
+        c->versions[e] = ecs->tick;
+  }
+}
+
+bool EcsRestore(ECS *ecs, Stream *in) {
+  Stream start = *in;
+  Snapshot snap;
+  if (!SnapshotParse(ecs, in, &snap)) {
+    in->pos = start.pos;
+    in->failed = true;
+    return false;
+  }
+  size_t end = in->pos;
+  Entity n = snap.count;
+
+  TagID *tags = malloc((snap.tag_count + 1) * sizeof(TagID));
+  if (!tags || !RestoreReserve(ecs, &snap)) {
+    free(tags);
+    in->pos = start.pos;
+    in->failed = true;
+    return false;
+  }
+  Layer layers[MaxLayers];
+  RestoreLayers(ecs, in, &snap, layers);
+  RestoreClear(ecs);
+  in->pos = snap.tag_names;
+  for (uint32_t t = 0; t < snap.tag_count; t++)
+    tags[t] = TagIntern(ecs, ReadName(ecs, in));
+
+  // entity columns
+  size_t words = ((size_t)n + 63) / 64;
+  uint64_t *bits[4] = {ecs->alive, ecs->active, ecs->visible, ecs->culled};
+  for (int b = 0; b < 4 && ecs->match_words > 0; b++) {
+    memcpy(bits[b], snap.bits[b], words * sizeof(uint64_t));
+    memset(bits[b] + words, 0, (ecs->match_words - words) * sizeof(uint64_t));
+  }
+  for (Entity e = 0; e < n; e++) {
+    Layer layer = 0;
+    if (snap.layers[e] < snap.layer_count)
+      layer = layers[snap.layers[e]];
+    ecs->entities[e] = (EntityData){
+        SnapshotSignature(&snap, snap.signatures[e]), NULL, InvalidID, layer,
+        0};
+    ecs->slots[e] = (RenderSlot){InvalidID, 0, snap.keys[e]};
+  }
+  if (snap.free_count > 0)
+    memcpy(ecs->free_entities, snap.free_list,
+           snap.free_count * sizeof(Entity));
+  ecs->entity_count = n;
+  ecs->free_count = snap.free_count;
+
+  for (Entity e = 0; e < n; e++)
+    if (StateGet(ecs->alive, e) && snap.tag_ids[e] < snap.tag_count)
+      AddEntityToTagID(ecs, e, tags[snap.tag_ids[e]]);
+  free(tags);
+
+  in->pos = snap.entries;
+  for (uint32_t l = 0; l < snap.layer_count; l++) {
+    StreamAlign(in, SNAPSHOT_ALIGN);
+    uint32_t entries = ReadU32(in);
+    const Entity *list = StreamView(in, entries * sizeof(Entity));
+    for (uint32_t i = 0; i < entries; i++)
+      if (list[i] < n && StateGet(ecs->alive, list[i]))
+        AddEntityToLayer(ecs, list[i], layers[l]);
+  }
+  RestoreColumns(ecs, in, &snap);
+
+  EcsMatchAll(ecs);
+  for (Entity e = 0; e < n; e++)
+    EcsStamp(ecs, e, &ecs->shaped[e]); // freed ones too
+
+  in->pos = end;
+  return true;
+}
+
+bool EcsSceneSave(ECS *ecs, const char *path) {
+  Stream out = {0};
+  bool ok = EcsSnapshot(ecs, &out) && StreamSave(&out, path);
+  StreamFree(&out);
+  return ok;
+}
+
+bool EcsSceneLoad(ECS *ecs, const char *path) {
+  Stream in = {0};
+  bool ok = StreamMap(&in, path) && EcsRestore(ecs, &in);
+  StreamFree(&in);
+  return ok;
+}
+
+// ####### //
+//  DELTA  //
+// ####### //
+
+#define DELTA_MAGIC 0x44434547u // "GECD"
+
+#define DELTA_ALIVE 1 // Entity is alive on the source
+#define DELTA_SHAPE 2 // Signature follows
+#define DELTA_SPAWN 4 // Entity was freed and created again
+
+uint32_t EcsChangeTick(ECS *ecs) { return ecs->tick; }
+
+void EcsComponentDelta(ECS *ecs, Component id, ComponentSave encode,
+                       ComponentLoad decode) {
+  assert(id < ecs->comp_count && "Component does not exist");
+  ecs->components[id].encode = encode;
+  ecs->components[id].decode = decode;
+}
+
+// Components replicated by deltas: the ones owning memory are local.
+static Signature DeltaComponents(ECS *ecs) {
+  Signature sent = 0;
+  for (Component i = 0; i < ecs->comp_count; i++)
+    if (!ecs->components[i].dtor)
+      sent |= 1ULL << i;
+  return sent;
+}
+
+// FNV-1a of the replicated components, both ends must agree.
+static uint32_t DeltaLayout(ECS *ecs) {
+  uint32_t hash = 2166136261u;
+  for (Component i = 0; i < ecs->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    if (c->dtor)
+      continue;
+    for (const char *s = c->name; *s; s++)
+      hash = (hash ^ (uint8_t)*s) * 16777619u;
+    hash = (hash ^ (uint32_t)c->size) * 16777619u;
+  }
+  return hash;
+}
+
+uint32_t EcsDelta(ECS *ecs, uint32_t since, Stream *out) {
+  Signature sent = DeltaComponents(ecs);
+  WriteU32(out, DELTA_MAGIC);
+  StreamWriteVarint(out, DeltaVersion);
+  WriteU32(out, DeltaLayout(ecs));
+
+  Entity prev = 0;
+  for (size_t w = 0; w < ecs->match_words; w++) {
+    if (ecs->chunks[w] <= since)
+      continue;
+    Entity end = (w + 1) * 64 < ecs->entity_count ? (Entity)((w + 1) * 64)
+                                                   : ecs->entity_count;
+    for (Entity e = (Entity)(w * 64); e < end; e++) {
+      Signature signature = ecs->entities[e].signature & sent;
+      Signature changed = 0;
+      for (Signature bits = signature; bits; bits &= bits - 1) {
+        int i = LowestBit(bits);
+        ComponentData *c = &ecs->components[i];
+        if (c->size > 0 && e < c->versioned && c->versions[e] > since)
+          changed |= 1ULL << i;
+      }
+      bool shape = ecs->shaped[e] > since;
+      if (!shape && !changed)
+        continue;
+
+      bool alive = StateGet(ecs->alive, e);
+      StreamWriteVarint(out, e - prev + 1); // 0 ends the delta
+      prev = e;
+      uint64_t flags = 0;
+      if (alive)
+        flags = DELTA_ALIVE | (shape ? DELTA_SHAPE : 0) |
+                (ecs->born[e] > since ? DELTA_SPAWN : 0);
+      StreamWriteVarint(out, flags);
+      if (!alive)
+        continue;
+      if (shape)
+        StreamWriteVarint(out, signature);
+      StreamWriteVarint(out, changed);
+      for (; changed; changed &= changed - 1) {
+        ComponentData *c = &ecs->components[LowestBit(changed)];
+        const uint8_t *data = (uint8_t *)c->list + (size_t)e * c->size;
+        if (c->encode)
+          c->encode(data, out);
+        else
+          StreamWrite(out, data, c->size);
+      }
+    }
+  }
+  StreamWriteVarint(out, 0);
+  return ecs->tick++;
+}
+
+// Creates the entity with the ID it has on the source registry.
+static bool DeltaEntity(ECS *ecs, Entity e) {
+  if (EcsEntityIsAlive(ecs, e))
+    return true;
+  if (e >= MaxEntities || !EcsMatchReserve(ecs, e))
+    return false;
+  uint32_t generation = 0;
+
+  if (e >= ecs->entity_count) {
+    // skipped IDs become free entities
+    Entity skipped = e - ecs->entity_count;
+    size_t alloc = MemEnsureCapacity((void **)&ecs->entities,
+                                     ecs->entity_alloc, (size_t)e + 1,
+                                     sizeof(EntityData));
+    if (!alloc)
+      return false;
+    ecs->entity_alloc = alloc;
+    alloc = MemEnsureCapacity((void **)&ecs->free_entities, ecs->free_alloc,
+                              (size_t)ecs->free_count + skipped + 1,
+                              sizeof(Entity));
+    if (!alloc)
+      return false;
+    ecs->free_alloc = alloc;
+    for (Entity i = ecs->entity_count; i < e; i++) {
+      ecs->entities[i] = (EntityData){0, NULL, InvalidID, 0, 0};
+      ecs->free_entities[ecs->free_count++] = i;
+    }
+    ecs->entity_count = e + 1;
+  } else {
+    generation = ecs->entities[e].generation;
+    for (Entity i = 0; i < ecs->free_count; i++) {
+      if (ecs->free_entities[i] == e) {
+        ecs->free_entities[i] = ecs->free_entities[--ecs->free_count];
+        break;
+      }
+    }
+  }
+  EntityInit(ecs, e, NULL, generation);
+  return true;
+}
+
+// Reads the records of a delta. Without apply, only checks that they fit.
+static bool DeltaRecords(ECS *ecs, Stream *in, Signature sent, uint8_t *tmp,
+                         bool apply) {
+  Entity e = 0;
+  for (uint64_t gap; (gap = StreamReadVarint(in)) != 0 && !in->failed;) {
+    if (e + gap - 1 >= MaxEntities)
+      return false;
+    e = (Entity)(e + gap - 1);
+    uint64_t flags = StreamReadVarint(in);
+    if (!(flags & DELTA_ALIVE)) {
+      if (apply && EcsEntityIsAlive(ecs, e))
+        EcsEntityFree(ecs, e);
+      continue;
+    }
+    if (apply && (flags & DELTA_SPAWN) && EcsEntityIsAlive(ecs, e))
+      EcsEntityFree(ecs, e);
+    if (apply && !DeltaEntity(ecs, e))
+      return false;
+
+    Signature local = EcsEntityIsAlive(ecs, e) ? ecs->entities[e].signature : 0;
+    local &= sent;
+    Signature signature = local;
+    if (flags & DELTA_SHAPE)
+      signature = StreamReadVarint(in);
+    Signature changed = StreamReadVarint(in);
+    if ((signature & ~sent) || (changed & ~signature))
+      return false;
+
+    // removed components first, then data, then added tags
+    if (!apply)
+      local = 0;
+    for (Signature bits = local & ~signature; bits; bits &= bits - 1)
+      EcsRemoveComponent(ecs, e, LowestBit(bits));
+    for (; changed; changed &= changed - 1) {
+      Component id = LowestBit(changed);
+      ComponentData *c = &ecs->components[id];
+      if (c->size == 0)
+        return false;
+      void *data = apply ? EcsGetComponent(ecs, e, id) : NULL;
+      if (data)
+        memcpy(tmp, data, c->size);
+      else
+        memset(tmp, 0, c->size);
+      if (c->decode)
+        c->decode(tmp, in);
+      else
+        StreamRead(in, tmp, c->size);
+      if (apply)
+        EcsAddComponent(ecs, e, id, tmp);
+    }
+    for (Signature bits = signature & ~local; apply && bits; bits &= bits - 1)
+      if (ecs->components[LowestBit(bits)].size == 0)
+        EcsAddComponent(ecs, e, LowestBit(bits), NULL);
+  }
+  return !in->failed;
+}
+
+bool EcsApplyDelta(ECS *ecs, Stream *in) {
+  Stream start = *in;
+  if (ReadU32(in) != DELTA_MAGIC || StreamReadVarint(in) != DeltaVersion ||
+      ReadU32(in) != DeltaLayout(ecs)) {
+    *in = start;
+    in->failed = true;
+    return false;
+  }
+
+  size_t size = 1;
+  for (Component i = 0; i < ecs->comp_count; i++)
+    if (ecs->components[i].size > size)
+      size = ecs->components[i].size;
+  uint8_t *tmp = malloc(size);
+  Signature sent = DeltaComponents(ecs);
+  size_t records = in->pos;
+  bool ok = tmp && DeltaRecords(ecs, in, sent, tmp, false);
+  if (ok) {
+    in->pos = records;
+    ok = DeltaRecords(ecs, in, sent, tmp, true);
+  } else {
+    *in = start;
+    in->failed = true;
+  }
+  free(tmp);
+  return ok;
+}
+
+
+// ########## //
+//  ROLLBACK  //
+// ########## //
+
+typedef struct {
+  Entity count;
+  Entity free_count;
+  Component comp_count;
+  EcsID layer_count;
+  TagID tag_count;
+  Entity tag_slots; // Saved entries of the tag slot map
+  Signature saved;  // Components kept by the frame
+  EcsID systems[EcsTotalPhases];
+} FrameHeader;
+
+// Raw copy of the tables: only this registry can read it back, so nothing is
+// named, versioned or aligned.
+static void FrameSave(ECS *ecs, Stream *out) {
+  Entity n = ecs->entity_count;
+  size_t words = ((size_t)n + 63) / 64;
+  if (n > 0 && !EntitySlot(ecs, n - 1)) {
+    out->failed = true;
+    return;
+  }
+  FrameHeader h = {n, ecs->free_count, ecs->comp_count, ecs->layer_count,
+                   ecs->tag_count, 0, 0, {0}};
+  h.tag_slots = n < ecs->tag_slot_alloc ? n : (Entity)ecs->tag_slot_alloc;
+  for (Component i = 0; i < ecs->comp_count; i++)
+    if (ComponentSaved(&ecs->components[i]))
+      h.saved |= 1ULL << i;
+  for (int p = 0; p < EcsTotalPhases; p++)
+    h.systems[p] = ecs->systems[p].size;
+
+  StreamWrite(out, &h, sizeof(FrameHeader));
+  StreamWrite(out, ecs->entities, n * sizeof(EntityData));
+  StreamWrite(out, ecs->free_entities, h.free_count * sizeof(Entity));
+  uint64_t *bits[4] = {ecs->alive, ecs->active, ecs->visible, ecs->culled};
+  for (int b = 0; b < 4; b++)
+    StreamWrite(out, bits[b], words * sizeof(uint64_t));
+  StreamWrite(out, ecs->slots, n * sizeof(RenderSlot));
+  StreamWrite(out, ecs->tag_slots, h.tag_slots * sizeof(Entity));
+  for (int p = 0; p < EcsTotalPhases; p++)
+    for (EcsID s = 0; s < h.systems[p]; s++)
+      StreamWrite(out, ecs->systems[p].list[s].match,
+                  words * sizeof(uint64_t));
+
+  for (Layer l = 0; l < h.layer_count; l++) {
+    LayerEntities *le = &ecs->render[l];
+    StreamWrite(out, le, sizeof(LayerEntities));
+    StreamWrite(out, le->entries, le->count * sizeof(LayerEntry));
+  }
+  for (TagID t = 0; t < h.tag_count; t++) {
+    TagInfo *info = &ecs->tags[t];
+    StreamWrite(out, &info->count, sizeof(Entity));
+    StreamWrite(out, info->entities, info->count * sizeof(Entity));
+  }
+
+  for (Component i = 0; i < h.comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    if (!(h.saved >> i & 1))
+      continue;
+    Signature bit = 1ULL << i;
+    size_t rows = c->size ? (n < c->alloc ? n : c->alloc) : 0;
+    while (rows > 0 && !(ecs->entities[rows - 1].signature & bit))
+      rows--; // up to the last owner, as in EcsSnapshot()
+    StreamWrite(out, &rows, sizeof(size_t));
+    StreamWrite(out, c->list, rows * c->size);
+
+    size_t at = out->size, extra = 0;
+    StreamWrite(out, &extra, sizeof(size_t));
+    for (Entity e = 0; c->save && e < rows; e++)
+      if (ecs->entities[e].signature & bit)
+        c->save((uint8_t *)c->list + (size_t)e * c->size, out);
+    if (!out->failed) {
+      extra = out->size - at - sizeof(size_t);
+      memcpy(out->data + at, &extra, sizeof(size_t));
+    }
+  }
+}
+
+// Checks that a saved array is in the frame, and grows the registry array
+// that receives it.
+static bool FrameReserve(Stream *in, void **list, size_t *alloc, size_t count,
+                         size_t size) {
+  if (!StreamView(in, count * size))
+    return false;
+  if (count == 0)
+    return true;
+  size_t grown = MemEnsureCapacity(list, *alloc, count, size);
+  if (!grown)
+    return false;
+  *alloc = grown;
+  return true;
+}
+
+// Walks the whole frame and grows every table it fills, so that nothing can
+// fail once the registry is being replaced. Records where each column is.
+static bool FramePrepare(ECS *ecs, Stream in, FrameHeader *h,
+                         size_t *sections) {
+  if (!StreamRead(&in, h, sizeof(FrameHeader)) || h->count > MaxEntities ||
+      h->free_count > h->count || h->tag_slots > h->count ||
+      h->comp_count > ecs->comp_count || h->layer_count > ecs->layer_count ||
+      h->tag_count > ecs->tag_count)
+    return false;
+  Entity n = h->count;
+  size_t words = ((size_t)n + 63) / 64;
+  if (n > 0 && (!EcsMatchReserve(ecs, n - 1) || !EntitySlot(ecs, n - 1)))
+    return false;
+
+  bool ok = FrameReserve(&in, (void **)&ecs->entities, &ecs->entity_alloc, n,
+                         sizeof(EntityData)) &&
+            FrameReserve(&in, (void **)&ecs->free_entities, &ecs->free_alloc,
+                         h->free_count, sizeof(Entity));
+  for (int b = 0; b < 4; b++)
+    StreamView(&in, words * sizeof(uint64_t));
+  StreamView(&in, n * sizeof(RenderSlot));
+  ok = ok && FrameReserve(&in, (void **)&ecs->tag_slots, &ecs->tag_slot_alloc,
+                          h->tag_slots, sizeof(Entity));
+  for (int p = 0; p < EcsTotalPhases; p++)
+    for (EcsID s = 0; s < h->systems[p]; s++)
+      StreamView(&in, words * sizeof(uint64_t));
+
+  for (Layer l = 0; ok && l < h->layer_count; l++) {
+    LayerEntities saved = {NULL, 0, 0, 0, false};
+    StreamRead(&in, &saved, sizeof(LayerEntities));
+    LayerEntities *le = &ecs->render[l];
+    ok = saved.holes <= saved.count &&
+         FrameReserve(&in, (void **)&le->entries, &le->alloc, saved.count,
+                      sizeof(LayerEntry));
+  }
+  for (TagID t = 0; ok && t < h->tag_count; t++) {
+    Entity count = 0;
+    StreamRead(&in, &count, sizeof(Entity));
+    TagInfo *info = &ecs->tags[t];
+    ok = FrameReserve(&in, (void **)&info->entities, &info->alloc, count,
+                      sizeof(Entity));
+  }
+
+  for (Component i = 0; ok && i < h->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    if (!(h->saved >> i & 1))
+      continue;
+    size_t rows = 0, extra = 0;
+    sections[i] = in.pos;
+    StreamRead(&in, &rows, sizeof(size_t));
+    ok = rows <= n && (c->size > 0 || rows == 0) &&
+         FrameReserve(&in, &c->list, &c->alloc, rows, c->size);
+    StreamRead(&in, &extra, sizeof(size_t));
+    StreamView(&in, extra);
+  }
+  return ok && !in.failed;
+}
+
+// Copies a saved array over a registry array grown by FramePrepare().
+static void FrameCopy(Stream *in, void *list, size_t count, size_t size) {
+  const void *src = StreamView(in, count * size);
+  if (src && count > 0)
+    memcpy(list, src, count * size);
+}
+
+static bool FrameInPlace(ComponentData *c, FrameHeader *h, Component i) {
+  return c->restore && i < h->comp_count && h->saved >> i & 1;
+}
+
+// Restores a column with a rollback hook before the entities are replaced:
+// entities owning the component on both sides keep their memory.
+static void FrameRestore(ECS *ecs, Component i, Stream in,
+                         const uint8_t *saved, Entity n) {
+  ComponentData *c = &ecs->components[i];
+  size_t rows = 0, extra = 0;
+  StreamRead(&in, &rows, sizeof(size_t));
+  const uint8_t *column = StreamView(&in, rows * c->size);
+  StreamRead(&in, &extra, sizeof(size_t));
+  Stream hooks = StreamReader(StreamView(&in, extra), extra);
+
+  Signature bit = 1ULL << i;
+  for (Entity e = 0; e < ecs->entity_count || e < rows; e++) {
+    uint8_t *row = (uint8_t *)c->list + (size_t)e * c->size;
+    const uint8_t *src = column + (size_t)e * c->size;
+    Signature owned = 0; // frames aren't aligned
+    if (e < rows && e < n)
+      memcpy(&owned, saved + (size_t)e * sizeof(EntityData) +
+                         offsetof(EntityData, signature),
+             sizeof(Signature));
+    bool live = e < ecs->entity_count && ecs->entities[e].signature & bit;
+    bool kept = owned & bit;
+    if (live && kept) {
+      c->restore(row, src, &hooks);
+      continue;
+    }
+    if (live && c->dtor)
+      c->dtor(row);
+    if (kept) {
+      memcpy(row, src, c->size);
+      if (c->load)
+        c->load(row, &hooks);
+    } else if (e < c->alloc) {
+      memset(row, 0, c->size);
+    }
+  }
+}
+
+static bool FrameLoad(ECS *ecs, Stream *in) {
+  FrameHeader h;
+  size_t sections[64];
+  if (!FramePrepare(ecs, *in, &h, sections))
+    return false;
+  StreamView(in, sizeof(FrameHeader));
+  Entity n = h.count;
+  size_t words = ((size_t)n + 63) / 64;
+  const uint8_t *saved = in->data + in->pos;
+
+  // the current owners release their data before the columns are replaced
+  for (Component i = 0; i < ecs->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    Signature bit = 1ULL << i;
+    if (FrameInPlace(c, &h, i)) {
+      Stream section = *in;
+      section.pos = sections[i];
+      FrameRestore(ecs, i, section, saved, n);
+      continue;
+    }
+    for (Entity e = 0; c->dtor && e < c->alloc && e < ecs->entity_count; e++)
+      if (ecs->entities[e].signature & bit)
+        c->dtor((uint8_t *)c->list + (size_t)e * c->size);
+  }
+  for (Entity e = n; e < ecs->entity_count; e++) {
+    ecs->entities[e] = (EntityData){0, NULL, InvalidID, 0, 0};
+    if (e < ecs->slot_alloc)
+      ecs->slots[e] = (RenderSlot){InvalidID, 0, 0};
+  }
+
+  FrameCopy(in, ecs->entities, n, sizeof(EntityData));
+  FrameCopy(in, ecs->free_entities, h.free_count, sizeof(Entity));
+  ecs->entity_count = n;
+  ecs->free_count = h.free_count;
+  for (Entity e = 0; e < n; e++)
+    ecs->entities[e].signature &= h.saved;
+
+  uint64_t *bits[4] = {ecs->alive, ecs->active, ecs->visible, ecs->culled};
+  for (int b = 0; b < 4; b++) {
+    FrameCopy(in, bits[b], words, sizeof(uint64_t));
+    if (ecs->match_words > words)
+      memset(bits[b] + words, 0,
+             (ecs->match_words - words) * sizeof(uint64_t));
+  }
+  FrameCopy(in, ecs->slots, n, sizeof(RenderSlot));
+  FrameCopy(in, ecs->tag_slots, h.tag_slots, sizeof(Entity));
+
+  // the matches are still valid unless a system or a dropped component was
+  // added since the save
+  bool matched = h.comp_count == ecs->comp_count &&
+                 h.saved == (h.comp_count < 64 ? (1ULL << h.comp_count) - 1
+                                               : ~0ULL);
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    matched &= h.systems[p] == ecs->systems[p].size;
+    for (EcsID s = 0; s < h.systems[p]; s++) {
+      const void *match = StreamView(in, words * sizeof(uint64_t));
+      if (!matched || ecs->match_words == 0)
+        continue;
+      uint64_t *bits = ecs->systems[p].list[s].match;
+      memcpy(bits, match, words * sizeof(uint64_t));
+      memset(bits + words, 0, (ecs->match_words - words) * sizeof(uint64_t));
+    }
+  }
+
+  for (Layer l = 0; l < ecs->layer_count; l++) {
+    LayerEntities *le = &ecs->render[l];
+    LayerEntities saved = {NULL, 0, 0, 0, false};
+    if (l < h.layer_count)
+      StreamRead(in, &saved, sizeof(LayerEntities));
+    FrameCopy(in, le->entries, saved.count, sizeof(LayerEntry));
+    le->count = saved.count;
+    le->holes = saved.holes;
+    le->dirty = saved.dirty;
+  }
+  for (TagID t = 0; t < ecs->tag_count; t++) {
+    TagInfo *info = &ecs->tags[t];
+    Entity count = 0;
+    if (t < h.tag_count)
+      StreamRead(in, &count, sizeof(Entity));
+    FrameCopy(in, info->entities, count, sizeof(Entity));
+    info->count = count;
+  }
+
+  for (Component i = 0; i < ecs->comp_count; i++) {
+    ComponentData *c = &ecs->components[i];
+    size_t rows = 0, extra = 0;
+    Stream hooks = {0};
+    bool in_place = FrameInPlace(c, &h, i);
+    if (i < h.comp_count && h.saved >> i & 1) {
+      StreamRead(in, &rows, sizeof(size_t));
+      const void *column = StreamView(in, rows * c->size);
+      if (!in_place && rows > 0)
+        memcpy(c->list, column, rows * c->size);
+      StreamRead(in, &extra, sizeof(size_t));
+      hooks = StreamReader(StreamView(in, extra), extra);
+    }
+    // dropped and destructed data doesn't stay past the column
+    if (c->size > 0 && c->alloc > rows)
+      memset((uint8_t *)c->list + c->size * rows, 0,
+             c->size * (c->alloc - rows));
+    Signature bit = 1ULL << i;
+    for (Entity e = 0; c->load && !in_place && e < rows; e++)
+      if (ecs->entities[e].signature & bit)
+        c->load((uint8_t *)c->list + (size_t)e * c->size, &hooks);
+    if (c->size == 0 || !ComponentVersions(c) || !c->versioned)
+      continue;
+    memset(c->versions, 0, c->versioned * sizeof(uint32_t));
+    for (Entity e = 0; e < rows; e++)
+      if (ecs->entities[e].signature & bit)
+        c->versions[e] = ecs->tick;
+  }
+
+  if (!matched)
+    EcsMatchAll(ecs);
+  for (Entity e = 0; e < n; e++)
+    EcsStamp(ecs, e, &ecs->shaped[e]);
+  return true;
+}
+
+Rollback RollbackCreate(uint32_t capacity) {
+  Rollback rb = {0};
+  rb.frames = calloc(capacity, sizeof(Stream));
+  rb.ids = calloc(capacity, sizeof(uint32_t));
+  if (!rb.frames || !rb.ids) {
+    RollbackFree(&rb);
+    return rb;
+  }
+  rb.capacity = capacity;
+  return rb;
+}
+
+void RollbackFree(Rollback *rb) {
+  for (uint32_t i = 0; rb->frames && i < rb->capacity; i++)
+    StreamFree(&rb->frames[i]);
+  free(rb->frames);
+  free(rb->ids);
+  *rb = (Rollback){0};
+}
+
+bool EcsSaveFrame(ECS *ecs, Rollback *rb, uint32_t frame) {
+  if (rb->capacity == 0)
+    return false;
+  Stream *s = &rb->frames[rb->head];
+  s->size = s->pos = 0;
+  s->failed = false;
+  FrameSave(ecs, s);
+  if (s->failed) {
+    if (rb->count == rb->capacity)
+      rb->count--; // the oldest frame was overwritten
+    return false;
+  }
+  rb->ids[rb->head] = frame;
+  rb->head = (rb->head + 1) % rb->capacity;
+  if (rb->count < rb->capacity)
+    rb->count++;
+  return true;
+}
+
+bool EcsLoadFrame(ECS *ecs, Rollback *rb, uint32_t frame) {
+  for (uint32_t k = 1; k <= rb->count; k++) {
+    uint32_t slot = (rb->head + rb->capacity - k) % rb->capacity;
+    if (rb->ids[slot] != frame)
+      continue;
+    Stream *s = &rb->frames[slot];
+    s->pos = 0;
+    s->failed = false;
+    if (!FrameLoad(ecs, s))
+      return false;
+    rb->head = (slot + 1) % rb->capacity;
+    rb->count -= k - 1;
+    return true;
+  }
+  return false;
+}
+
+void EcsComponentRollback(ECS *ecs, Component id, ComponentRestore restore) {
+  assert(id < ecs->comp_count && "Component does not exist");
+  ecs->components[id].restore = restore;
+}
+
+// ###### //
+//  HASH  //
+// ###### //
+
+#define HASH_BASIS 14695981039346656037ull // FNV-1a 64
+#define HASH_PRIME 1099511628211ull
+
+void EcsComponentHash(ECS *ecs, Component id, ComponentSave hash) {
+  assert(id < ecs->comp_count && "Component does not exist");
+  ecs->components[id].hash = hash;
+}
+
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t n) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < n; i++)
+    hash = (hash ^ bytes[i]) * HASH_PRIME;
+  return hash;
+}
+
+uint64_t EcsStateHash(ECS *ecs, Signature components) {
+  uint64_t hash = HASH_BASIS;
+  Stream fields = {0};
+  hash = HashBytes(hash, &ecs->entity_count, sizeof(Entity));
+  for (Entity e = 0; e < ecs->entity_count; e++) {
+    bool alive = StateGet(ecs->alive, e);
+    Signature signature = alive ? ecs->entities[e].signature & components : 0;
+    hash = HashBytes(hash, &alive, sizeof(bool));
+    hash = HashBytes(hash, &signature, sizeof(Signature));
+    for (Signature bits = signature; bits; bits &= bits - 1) {
+      ComponentData *c = &ecs->components[LowestBit(bits)];
+      const void *data = (uint8_t *)c->list + (size_t)e * c->size;
+      if (c->hash) {
+        fields.size = 0;
+        c->hash(data, &fields);
+        hash = HashBytes(hash, fields.data, fields.size);
+      } else if (!c->dtor) {
+        hash = HashBytes(hash, data, c->size);
+      }
+    }
+  }
+  StreamFree(&fields);
+  return hash;
+}
+
+// ######### //
+//  PROFILE  //
+// ######### //
+
+#if defined(GEARECS_PROFILE)
+void EcsProfileFrame(ECS *ecs) {
+  ecs->profile_frame++;
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    PhaseSystem *ps = &ecs->systems[p];
+    *ProfileCurrent(ecs, ps->total) = (ProfileSample){0};
+    for (EcsID s = 0; s < ps->size; s++)
+      *ProfileCurrent(ecs, ps->profile[s]) = (ProfileSample){0};
+  }
+}
+
+// Adds up the closed frames of the window.
+static EcsProfile ProfileSum(ECS *ecs, const ProfileSample *ring,
+                             const char *name) {
+  EcsProfile profile = {name, 0, 0, 0, 0, 0, 0};
+  uint32_t frames = ecs->profile_frame < ProfileWindow ? ecs->profile_frame
+                                                       : ProfileWindow;
+  for (uint32_t k = 1; k <= frames; k++) {
+    const ProfileSample *sample =
+        &ring[(ecs->profile_frame - k) % (ProfileWindow + 1)];
+    profile.calls += sample->calls;
+    profile.time += sample->time;
+    profile.visited += sample->visited;
+    profile.matched += sample->matched;
+    if (sample->time > profile.max)
+      profile.max = sample->time;
+  }
+  profile.frames = frames;
+  return profile;
+}
+
+EcsProfile EcsProfileSystem(ECS *ecs, EcsPhase phase, EcsID system) {
+  assert(system < EcsSystemCount(ecs, phase) && "System does not exist");
+  PhaseSystem *ps = &ecs->systems[phase];
+  return ProfileSum(ecs, ps->profile[system], ps->list[system].name);
+}
+
+EcsProfile EcsProfilePhase(ECS *ecs, EcsPhase phase) {
+  assert(phase < EcsTotalPhases && "Phase does not exist");
+  return ProfileSum(ecs, ecs->systems[phase].total, PhaseNames[phase]);
+}
+#else
+void EcsProfileFrame(ECS *ecs) { (void)ecs; }
+
+EcsProfile EcsProfileSystem(ECS *ecs, EcsPhase phase, EcsID system) {
+  assert(system < EcsSystemCount(ecs, phase) && "System does not exist");
+  return (EcsProfile){ecs->systems[phase].list[system].name, 0, 0, 0, 0, 0, 0};
+}
+
+EcsProfile EcsProfilePhase(ECS *ecs, EcsPhase phase) {
+  (void)ecs;
+  assert(phase < EcsTotalPhases && "Phase does not exist");
+  return (EcsProfile){PhaseNames[phase], 0, 0, 0, 0, 0, 0};
+}
+#endif
+
+static void ProfileText(Stream *out, EcsProfile *p, bool system) {
+  double frames = p->frames ? p->frames : 1;
+  StreamPrintf(out, "%s%-*s %7.3f %7.3f %6.1f %9.0f %9.0f\n",
+               system ? "  " : "", system ? 28 : 30, p->name ? p->name : "?",
+               p->time * 1e3 / frames, p->max * 1e3, p->calls / frames,
+               p->visited / frames, p->matched / frames);
+}
+
+static void ProfileJson(Stream *out, EcsProfile *p) {
+  StreamPrintf(out, "\"name\":");
+  StreamPrintJson(out, p->name);
+  StreamPrintf(out,
+               ",\"frames\":%u,\"calls\":%u,\"time\":%.9f,\"max\":%.9f,"
+               "\"visited\":%llu,\"matched\":%llu",
+               p->frames, p->calls, p->time, p->max,
+               (unsigned long long)p->visited,
+               (unsigned long long)p->matched);
+}
+
+bool EcsProfileDump(ECS *ecs, Stream *out, bool json) {
+  if (json)
+    StreamPrintf(out, "{\"window\":%d,\"phases\":[", ProfileWindow);
+  else
+    StreamPrintf(out, "%-30s %7s %7s %6s %9s %9s\n", "per frame", "ms",
+                 "max ms", "calls", "visited", "matched");
+
+  for (int p = 0; p < EcsTotalPhases; p++) {
+    EcsProfile phase = EcsProfilePhase(ecs, (EcsPhase)p);
+    if (json) {
+      StreamPrintf(out, "%s{", p ? "," : "");
+      ProfileJson(out, &phase);
+      StreamPrintf(out, ",\"systems\":[");
+    } else if (EcsSystemCount(ecs, (EcsPhase)p) > 0) {
+      ProfileText(out, &phase, false);
+    }
+    for (EcsID s = 0; s < EcsSystemCount(ecs, (EcsPhase)p); s++) {
+      EcsProfile system = EcsProfileSystem(ecs, (EcsPhase)p, s);
+      if (json) {
+        StreamPrintf(out, "%s{", s ? "," : "");
+        ProfileJson(out, &system);
+        StreamPrintf(out, "}");
+      } else {
+        ProfileText(out, &system, true);
+      }
+    }
+    if (json)
+      StreamPrintf(out, "]}");
+  }
+  if (json)
+    StreamPrintf(out, "]}\n");
+  return !out->failed;
+}
+
+// ####### //
+//  TRACE  //
+// ####### //
+
+void EcsSetTrace(ECS *ecs, Trace *trace) { ecs->trace = trace; }
+
+Trace *EcsTrace(ECS *ecs) { return ecs->trace; }
@@ -1,17 +1,27 @@
 #include <ecs/component.h>
 #include <ecs/system.h>
 
+#include <mem/array.h>
+#include <mem/job.h>
+#include <mem/simmath.h>
+
+#include <stdlib.h>
+
 void TransformColliderSystem(ECS *ecs, Entity e) {
   Transform2 *t = GetComponent(ecs, e, Transform2);
   Collider *c = GetComponent(ecs, e, Collider);
 
-  float angle = t->rotation;
+  float cosr = SimCosf(t->rotation);
+  float sinr = SimSinf(t->rotation);
+  Vector2 min = {INFINITY, INFINITY};
+  Vector2 max = {-INFINITY, -INFINITY};
   for (uint8_t i = 0; i < c->vertices; i++) {
-    c->vx[i].x =
-        c->md[i].x * cosf(angle) - c->md[i].y * sinf(angle) + t->position.x;
-    c->vx[i].y =
-        c->md[i].x * sinf(angle) + c->md[i].y * cosf(angle) + t->position.y;
+    c->vx[i].x = c->md[i].x * cosr - c->md[i].y * sinr + t->position.x;
+    c->vx[i].y = c->md[i].x * sinr + c->md[i].y * cosr + t->position.y;
+    min = Vector2Min(min, c->vx[i]);
+    max = Vector2Max(max, c->vx[i]);
   }
+  c->box = (Rectangle){min.x, min.y, max.x - min.x, max.y - min.y};
   c->overlap = false;
 }
 
@@ -106,78 +116,721 @@ uint8_t CollisionSat(Transform2 *ta, Collider *ca, Transform2 *tb, Collider *cb,
   return true;
 }
 
-void ResolveCollision(Collision *input, Transform2 *ta, RigidBody *ra,
-                      Transform2 *tb, RigidBody *rb) {
-  float invmassA = (ra && ra->type == BodyDynamic) ? ra->invmass : 0;
-  float invmassB = (rb && rb->type == BodyDynamic) ? rb->invmass : 0;
-  if (invmassA + invmassB == 0)
+// CONTACT CACHE
+
+static uint32_t PairKey(Entity a, Entity b) { return ((uint32_t)a << 16) | b; }
+
+static bool BoxOverlap(Rectangle a, Rectangle b) {
+  return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+         a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+static Contact *CachedContact(CollisionWorld *cw, Entity a, Entity b) {
+  uint32_t key = PairKey(a, b);
+  size_t lo = 0, hi = cw->cached;
+  while (lo < hi) {
+    size_t k = (lo + hi) / 2;
+    uint32_t ck = PairKey(cw->cache[k].a, cw->cache[k].b);
+    if (ck == key)
+      return &cw->cache[k];
+    if (ck < key)
+      lo = k + 1;
+    else
+      hi = k;
+  }
+  return NULL;
+}
+
+static void GatherColliders(ECS *ecs, CollisionWorld *cw) {
+  EcsQuery query = {
+      .with = EcsSignature(ecs, Transform2, Collider),
+      .optional = EcsSignature(ecs, RigidBody, CollisionListener),
+  };
+  Component listener = ComponentID(ecs, CollisionListener);
+  cw->body_count = 0;
+  for (Entity e = 0; e < EcsEntityEnd(ecs); e++) {
+    if (!EcsQueryMatches(ecs, e, query) || !EntityIsActive(ecs, e))
+      continue;
+    CollisionBody body = {e,
+                          EcsEntityData(ecs, e)->layer,
+                          EcsHasComponent(ecs, e, listener),
+                          GetComponent(ecs, e, Transform2),
+                          GetComponent(ecs, e, Collider),
+                          GetComponent(ecs, e, RigidBody),
+                          cw->body_count,
+                          false,
+                          0,
+                          0};
+    cw->body_alloc = MemPushBack((void **)&cw->bodies, cw->body_alloc,
+                                 cw->body_count++, &body, sizeof(body));
+  }
+}
+
+// SOLVER
+
+#define SOLVER_SLOP 0.5f      ///< Allowed penetration (units)
+#define SOLVER_PERCENT 0.8f   ///< Penetration corrected per step
+#define SOLVER_BOUNCE 1.f     ///< Minimum approach speed for restitution
+
+static bool IsDynamic(CollisionBody *b) {
+  return b->body && b->body->type == BodyDynamic;
+}
+
+static bool IsAsleep(CollisionBody *b) { return b->body && b->body->sleeping; }
+
+// Sleeping bodies only rest on sleeping or static bodies.
+static bool IsResting(CollisionBody *b) {
+  return b->body && (b->body->sleeping || b->body->type == BodyStatic);
+}
+
+static float InvMass(CollisionBody *b) {
+  return IsDynamic(b) && !b->body->sleeping ? b->body->invmass : 0;
+}
+
+static Vector2 Speed(CollisionBody *b) {
+  return b->body ? b->body->speed : (Vector2){0, 0};
+}
+
+static Entity IslandFind(CollisionWorld *cw, Entity i) {
+  while (cw->bodies[i].island != i) {
+    cw->bodies[i].island = cw->bodies[cw->bodies[i].island].island;
+    i = cw->bodies[i].island;
+  }
+  return i;
+}
+
+static bool IsSolid(CollisionWorld *cw, Contact *c) {
+  return cw->bodies[c->ia].collider->solid && cw->bodies[c->ib].collider->solid;
+}
+
+static bool IsSolvable(CollisionWorld *cw, Contact *c) {
+  float invmass = InvMass(&cw->bodies[c->ia]) + InvMass(&cw->bodies[c->ib]);
+  return IsSolid(cw, c) && invmass > 0;
+}
+
+static Entity ContactIsland(CollisionWorld *cw, Contact *c) {
+  return cw->bodies[InvMass(&cw->bodies[c->ia]) > 0 ? c->ia : c->ib].island;
+}
+
+// Connects dynamic bodies touching each other. Static and kinematic bodies
+// never join islands, so islands only share read-only bodies.
+static void BuildIslands(CollisionWorld *cw) {
+  for (size_t i = 0; i < cw->count; i++) {
+    Contact *c = &cw->contacts[i];
+    if (!IsSolid(cw, c) || !IsDynamic(&cw->bodies[c->ia]) ||
+        !IsDynamic(&cw->bodies[c->ib]))
+      continue;
+    Entity ra = IslandFind(cw, c->ia);
+    Entity rb = IslandFind(cw, c->ib);
+    if (ra < rb)
+      cw->bodies[rb].island = ra;
+    else
+      cw->bodies[ra].island = rb;
+  }
+  for (size_t i = 0; i < cw->body_count; i++) {
+    cw->bodies[i].island = IslandFind(cw, i);
+    cw->bodies[i].awake = false;
+    cw->bodies[i].idle = INFINITY;
+    cw->bodies[i].slot = 0;
+  }
+}
+
+// An island is either fully awake or fully asleep.
+static void WakeIslands(CollisionWorld *cw) {
+  for (size_t i = 0; i < cw->body_count; i++)
+    if (IsDynamic(&cw->bodies[i]) && !cw->bodies[i].body->sleeping)
+      cw->bodies[cw->bodies[i].island].awake = true;
+
+  for (size_t i = 0; i < cw->body_count; i++)
+    if (IsAsleep(&cw->bodies[i]) && cw->bodies[cw->bodies[i].island].awake)
+      WakeBody(cw->bodies[i].body);
+}
+
+// Counting sort of the solid contacts by island: contacts are already sorted
+// by pair, so the order inside each island doesn't depend on the islands.
+static void SortIslands(CollisionWorld *cw) {
+  cw->island_count = 0;
+  cw->order_alloc = MemEnsureCapacity((void **)&cw->order, cw->order_alloc,
+                                      cw->count, sizeof(size_t));
+
+  for (size_t i = 0; i < cw->count; i++)
+    if (IsSolvable(cw, &cw->contacts[i]))
+      cw->bodies[ContactIsland(cw, &cw->contacts[i])].slot++;
+
+  size_t first = 0;
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *root = &cw->bodies[i];
+    if (root->island != i || root->slot == 0)
+      continue;
+    Island island = {i, first, root->slot};
+    cw->island_alloc =
+        MemPushBack((void **)&cw->islands, cw->island_alloc,
+                    cw->island_count++, &island, sizeof(Island));
+    root->slot = first;
+    first += island.count;
+  }
+
+  for (size_t i = 0; i < cw->count; i++)
+    if (IsSolvable(cw, &cw->contacts[i]))
+      cw->order[cw->bodies[ContactIsland(cw, &cw->contacts[i])].slot++] = i;
+}
+
+static void ApplyContactImpulse(CollisionWorld *cw, Contact *c, float lambda) {
+  CollisionBody *a = &cw->bodies[c->ia], *b = &cw->bodies[c->ib];
+  Vector2 impulse = Vector2Scale(c->collision.normal, lambda);
+  if (InvMass(a) > 0)
+    a->body->speed = Vector2Subtract(a->body->speed,
+                                     Vector2Scale(impulse, InvMass(a)));
+  if (InvMass(b) > 0)
+    b->body->speed =
+        Vector2Add(b->body->speed, Vector2Scale(impulse, InvMass(b)));
+}
+
+static float NormalSpeed(CollisionWorld *cw, Contact *c) {
+  Vector2 delta = Vector2Subtract(Speed(&cw->bodies[c->ib]),
+                                  Speed(&cw->bodies[c->ia]));
+  return Vector2DotProduct(delta, c->collision.normal);
+}
+
+// Sequential impulses with accumulated clamping and warm starting, followed
+// by a single positional correction pass.
+static void SolveIsland(CollisionWorld *cw, Island *island) {
+  size_t *order = &cw->order[island->first];
+  uint8_t iterations = cw->iterations ? cw->iterations : 1;
+
+  for (size_t k = 0; k < island->count; k++) {
+    Contact *c = &cw->contacts[order[k]];
+    CollisionBody *a = &cw->bodies[c->ia], *b = &cw->bodies[c->ib];
+    float vn = NormalSpeed(cw, c);
+    float e = fmaxf(a->body ? a->body->restitution : 0,
+                    b->body ? b->body->restitution : 0);
+    c->bounce = vn < -SOLVER_BOUNCE ? -e * vn : 0;
+    ApplyContactImpulse(cw, c, c->impulse);
+  }
+
+  for (uint8_t it = 0; it < iterations; it++) {
+    for (size_t k = 0; k < island->count; k++) {
+      Contact *c = &cw->contacts[order[k]];
+      float invmass = InvMass(&cw->bodies[c->ia]) + InvMass(&cw->bodies[c->ib]);
+      float lambda = (c->bounce - NormalSpeed(cw, c)) / invmass;
+      float total = fmaxf(c->impulse + lambda, 0);
+      ApplyContactImpulse(cw, c, total - c->impulse);
+      c->impulse = total;
+    }
+  }
+
+  for (size_t k = 0; k < island->count; k++) {
+    Contact *c = &cw->contacts[order[k]];
+    CollisionBody *a = &cw->bodies[c->ia], *b = &cw->bodies[c->ib];
+    float invmass = InvMass(a) + InvMass(b);
+    float depth = fmaxf(c->collision.distance - SOLVER_SLOP, 0);
+    Vector2 delta =
+        Vector2Scale(c->collision.normal, depth * SOLVER_PERCENT / invmass);
+    // bodies outside the island may be shared with other islands
+    if (InvMass(a) > 0)
+      a->transform->position = Vector2Subtract(
+          a->transform->position, Vector2Scale(delta, InvMass(a)));
+    if (InvMass(b) > 0)
+      b->transform->position =
+          Vector2Add(b->transform->position, Vector2Scale(delta, InvMass(b)));
+  }
+}
+
+// Islands whose bodies rest long enough fall asleep together.
+static void SleepIslands(CollisionWorld *cw, float dt) {
+  if (cw->sleepSpeed <= 0)
     return;
 
-  float deltaMagnitude = input->distance / (invmassA + invmassB);
-  Vector2 delta = Vector2Scale(input->normal, deltaMagnitude);
-  ta->position = Vector2Subtract(ta->position, Vector2Scale(delta, invmassA));
-  tb->position = Vector2Add(tb->position, Vector2Scale(delta, invmassB));
+  float limit = cw->sleepSpeed * cw->sleepSpeed;
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *b = &cw->bodies[i];
+    if (!IsDynamic(b) || b->body->sleeping)
+      continue;
+    if (Vector2LengthSqr(b->body->speed) < limit)
+      b->body->idle += dt;
+    else
+      b->body->idle = 0;
+    CollisionBody *root = &cw->bodies[b->island];
+    root->idle = fminf(root->idle, b->body->idle);
+  }
 
-  Vector2 deltaSpeed = Vector2Subtract(rb ? rb->speed : (Vector2){0, 0},
-                                       ra ? ra->speed : (Vector2){0, 0});
-  float speedAlongNormal = Vector2DotProduct(deltaSpeed, input->normal);
-  if (speedAlongNormal > 0) // rigidbodies separated
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *b = &cw->bodies[i];
+    if (!IsDynamic(b) || b->body->sleeping ||
+        cw->bodies[b->island].idle < cw->sleepTime)
+      continue;
+    b->body->sleeping = true;
+    b->body->speed = (Vector2){0, 0};
+    b->body->acc = (Vector2){0, 0};
+  }
+}
+
+// Mirrors the body state in the Sleeping tag, so systems can leave sleeping
+// bodies out of their queries. Only done when the tag is registered.
+// Bodies moved by the solver are the awake ones, and the ones falling asleep
+// on this step (not tagged yet).
+static void MarkMovedBodies(ECS *ecs, CollisionWorld *cw) {
+  Component transform = ComponentID(ecs, Transform2);
+  Component body = ComponentID(ecs, RigidBody);
+  Component tag = ComponentID(ecs, Sleeping);
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *b = &cw->bodies[i];
+    if (!IsDynamic(b) || (b->body->sleeping && tag != InvalidID &&
+                          EcsHasComponent(ecs, b->entity, tag)))
+      continue;
+    EcsMarkChanged(ecs, b->entity, transform);
+    EcsMarkChanged(ecs, b->entity, body);
+  }
+}
+
+static void TagSleepingBodies(ECS *ecs, CollisionWorld *cw) {
+  Component tag = ComponentID(ecs, Sleeping);
+  if (tag == InvalidID)
     return;
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *b = &cw->bodies[i];
+    if (!b->body || b->body->sleeping == EcsHasComponent(ecs, b->entity, tag))
+      continue;
+    if (b->body->sleeping)
+      EcsAddComponent(ecs, b->entity, tag, NULL);
+    else
+      EcsRemoveComponent(ecs, b->entity, tag);
+  }
+}
+
+// EVENTS
+
+static void PushEvent(CollisionWorld *cw, Entity self, Entity other,
+                      Collision collision, CollisionState state) {
+  CollisionEvent event = {self, other, collision, state};
+  cw->event_alloc = MemPushBack((void **)&cw->events, cw->event_alloc,
+                                cw->event_count++, &event, sizeof(event));
+}
+
+// An entity of a cached contact is gone once it lost its collider or was
+// freed, even if its ID was reused since.
+static bool ContactKept(ECS *ecs, Entity e, uint32_t generation,
+                        Component collider) {
+  return EcsEntityIsAlive(ecs, e) && EcsHasComponent(ecs, e, collider) &&
+         EcsEntityData(ecs, e)->generation == generation;
+}
+
+static void PushContactEvents(ECS *ecs, CollisionWorld *cw, Component listener,
+                              Contact *contact, CollisionState state) {
+  bool to_a = true, to_b = true;
+  if (state == CollisionExit) { // gone entities get no exit
+    Component collider = ComponentID(ecs, Collider);
+    to_a = ContactKept(ecs, contact->a, contact->ga, collider);
+    to_b = ContactKept(ecs, contact->b, contact->gb, collider);
+  }
+  if (to_a && EcsHasComponent(ecs, contact->a, listener))
+    PushEvent(cw, contact->a, contact->b, contact->collision, state);
+  if (to_b && EcsHasComponent(ecs, contact->b, listener)) {
+    Collision mirror = {Vector2Negate(contact->collision.normal),
+                        contact->collision.distance};
+    PushEvent(cw, contact->b, contact->a, mirror, state);
+  }
+}
+
+// A pair of reused IDs has an exit and an enter with the same key: qsort isn't
+// stable, so the exit is ordered first explicitly.
+static int EventCompare(const void *a, const void *b) {
+  const CollisionEvent *ea = a, *eb = b;
+  uint32_t ka = PairKey(ea->self, ea->other);
+  uint32_t kb = PairKey(eb->self, eb->other);
+  if (ka != kb)
+    return (ka > kb) - (ka < kb);
+  bool xa = ea->state == CollisionExit, xb = eb->state == CollisionExit;
+  return (int)xb - (int)xa;
+}
+
+// Both contact lists are sorted by pair: merge them to find enter, stay and
+// exit, then sort the events by listener.
+static void BuildCollisionEvents(ECS *ecs, CollisionWorld *cw) {
+  Component listener = ComponentID(ecs, CollisionListener);
+  cw->event_count = 0;
+
+  size_t i = 0, j = 0;
+  while (i < cw->count || j < cw->cached) {
+    uint32_t ki = i < cw->count ? PairKey(cw->contacts[i].a, cw->contacts[i].b)
+                                : UINT32_MAX;
+    uint32_t kj = j < cw->cached ? PairKey(cw->cache[j].a, cw->cache[j].b)
+                                 : UINT32_MAX;
+    // a pair of reused IDs is a new contact
+    if (ki == kj && (cw->contacts[i].ga != cw->cache[j].ga ||
+                     cw->contacts[i].gb != cw->cache[j].gb)) {
+      PushContactEvents(ecs, cw, listener, &cw->cache[j++], CollisionExit);
+      PushContactEvents(ecs, cw, listener, &cw->contacts[i++], CollisionEnter);
+    } else if (ki == kj) {
+      PushContactEvents(ecs, cw, listener, &cw->contacts[i++], CollisionStay);
+      j++;
+    } else if (ki < kj) {
+      PushContactEvents(ecs, cw, listener, &cw->contacts[i++], CollisionEnter);
+    } else {
+      PushContactEvents(ecs, cw, listener, &cw->cache[j++], CollisionExit);
+    }
+  }
+
+  if (cw->event_count > 1)
+    qsort(cw->events, cw->event_count, sizeof(CollisionEvent), EventCompare);
+}
 
-  float e = 0;
-  float impulseMagnitute = -(1 + e) * speedAlongNormal / (invmassA + invmassB);
-  Vector2 impulse = Vector2Scale(input->normal, impulseMagnitute);
-  if (ra && ra->type == BodyDynamic)
-    ra->speed = Vector2Subtract(ra->speed, Vector2Scale(impulse, invmassA));
-  if (rb && rb->type == BodyDynamic)
-    rb->speed = Vector2Add(rb->speed, Vector2Scale(impulse, invmassB));
+// Runs after the pair loop: handlers may modify the registry freely.
+static void DispatchCollisionEvents(ECS *ecs, CollisionWorld *cw) {
+  size_t i = 0;
+  while (i < cw->event_count) {
+    Entity self = cw->events[i].self;
+    CollisionListener *found = GetComponent(ecs, self, CollisionListener);
+    if (!found) { // destroyed by a previous handler
+      while (i < cw->event_count && cw->events[i].self == self)
+        i++;
+      continue;
+    }
+
+    // handlers may add components and move the listener storage
+    CollisionListener listener = *found;
+    for (; i < cw->event_count && cw->events[i].self == self; i++) {
+      CollisionEvent event = cw->events[i];
+      if (event.state != CollisionExit && listener.OnCollision)
+        listener.OnCollision(ecs, &event);
+
+      CollisionHandler handler = listener.OnCollisionExit;
+      if (event.state == CollisionEnter)
+        handler = listener.OnCollisionEnter;
+      else if (event.state == CollisionStay)
+        handler = listener.OnCollisionStay;
+      if (handler)
+        handler(ecs, &event);
+    }
+  }
 }
 
-void HandleCollisionEvents(ECS *ecs, Entity self, Entity other,
-                           Collision *collision) {
-  CollisionListener *listener_a = GetComponent(ecs, self, CollisionListener);
-  if (listener_a) {
-    CollisionEvent event = {self, other, *collision};
-    listener_a->OnCollision(ecs, &event);
+// CONTINUOUS COLLISIONS
+
+#define CCD_STEPS 64 ///< Maximum samples of a sweep against a collider
+#define CCD_REFINE 8 ///< Bisection steps refining the time of impact
+
+// Interval of [0, 1] where a box moved by d overlaps another box.
+static bool SweepInterval(Rectangle box, Vector2 d, Rectangle other, float *t0,
+                          float *t1) {
+  float min[2] = {box.x, box.y}, size[2] = {box.width, box.height};
+  float omin[2] = {other.x, other.y}, osize[2] = {other.width, other.height};
+  float delta[2] = {d.x, d.y};
+  *t0 = 0;
+  *t1 = 1;
+  for (int k = 0; k < 2; k++) {
+    float enter = omin[k] - (min[k] + size[k]);
+    float leave = omin[k] + osize[k] - min[k];
+    if (delta[k] == 0) {
+      if (enter > 0 || leave < 0)
+        return false;
+      continue;
+    }
+    float a = enter / delta[k], b = leave / delta[k];
+    *t0 = fmaxf(*t0, fminf(a, b));
+    *t1 = fminf(*t1, fmaxf(a, b));
   }
+  return *t0 <= *t1;
+}
 
-  CollisionListener *listener_b = GetComponent(ecs, other, CollisionListener);
-  if (listener_b) {
-    CollisionEvent event = {
-        other, self, {Vector2Negate(collision->normal), collision->distance}};
-    listener_b->OnCollision(ecs, &event);
+// Tests the collider of a at origin + d * t against b.
+static bool SweepHit(CollisionBody *a, Vector2 origin, Vector2 d, float t,
+                     CollisionBody *b) {
+  Vector2 vx[UINT8_MAX];
+  Vector2 offset = Vector2Subtract(Vector2Add(origin, Vector2Scale(d, t)),
+                                   a->transform->position);
+  Collider moved = *a->collider;
+  moved.vx = vx;
+  for (uint8_t i = 0; i < moved.vertices; i++)
+    vx[i] = Vector2Add(a->collider->vx[i], offset);
+  Transform2 at = *a->transform;
+  at.position = Vector2Add(at.position, offset);
+
+  Collision collision;
+  return CollisionSat(&at, &moved, b->transform, b->collider, &collision);
+}
+
+// Samples the overlap interval with steps of half the body size, so no
+// collider is skipped, then bisects the first hit.
+static float SweepImpact(CollisionBody *a, Vector2 origin, Vector2 d,
+                         float step, float t0, float t1, CollisionBody *b) {
+  int steps = (int)ceilf((t1 - t0) / step);
+  if (steps > CCD_STEPS)
+    steps = CCD_STEPS;
+  if (steps < 1)
+    steps = 1;
+
+  float prev = t0;
+  for (int k = 0; k <= steps; k++) {
+    float t = t0 + (t1 - t0) * k / steps;
+    if (!SweepHit(a, origin, d, t, b)) {
+      prev = t;
+      continue;
+    }
+    if (k == 0)
+      return t0;
+    float lo = prev, hi = t;
+    for (int i = 0; i < CCD_REFINE; i++) {
+      float mid = (lo + hi) * .5f;
+      if (SweepHit(a, origin, d, mid, b))
+        hi = mid;
+      else
+        lo = mid;
+    }
+    return hi;
   }
+  return INFINITY;
 }
 
-void CollisionSystem(ECS *ecs, Entity self) {
-  Transform2 *ta = GetComponent(ecs, self, Transform2);
-  Collider *ca = GetComponent(ecs, self, Collider);
-  RigidBody *ra = GetComponent(ecs, self, RigidBody);
-  uint8_t la = EcsEntityData(ecs, self)->layer;
+// Fast bodies flagged with ccd are swept from their position at the start of
+// the step. A body hitting a solid collider is moved back to the time of
+// impact (barely overlapping), so the narrow-phase and the solver handle the
+// contact as usual. The sweep is a translation: rotation isn't swept.
+static void SweepBodies(ECS *ecs, CollisionWorld *cw) {
+  const Signature *layers = LayerMatrix(ecs);
+  for (size_t i = 0; i < cw->body_count; i++) {
+    CollisionBody *a = &cw->bodies[i];
+    if (!a->body || !a->body->ccd || InvMass(a) == 0 || !a->collider->solid)
+      continue;
 
-  Signature mask = EcsSignature(ecs, Transform2, Collider);
-  for (Entity other = self + 1; other < EcsEntityCount(ecs); ++other) {
-    if (!EcsHasComponents(ecs, other, mask))
+    Rectangle box = a->collider->box;
+    Vector2 d = Vector2Subtract(a->transform->position, a->body->origin);
+    float size = fminf(box.width, box.height) * .5f;
+    float length = Vector2Length(d);
+    if (length <= size)
+      continue; // slow enough for the discrete test
+
+    box.x -= d.x;
+    box.y -= d.y;
+    Rectangle swept = {fminf(box.x, box.x + d.x), fminf(box.y, box.y + d.y),
+                       box.width + fabsf(d.x), box.height + fabsf(d.y)};
+
+    float toi = INFINITY;
+    for (size_t j = 0; j < cw->body_count; j++) {
+      CollisionBody *b = &cw->bodies[j];
+      float t0, t1;
+      if (j == i || !b->collider->solid ||
+          !LayerMatrixIncludes(layers, a->layer, b->layer) ||
+          !BoxOverlap(swept, b->collider->box) ||
+          !SweepInterval(box, d, b->collider->box, &t0, &t1) || t0 <= 0 ||
+          t0 >= toi)
+        continue; // colliders touched at the start are left to the SAT
+      toi = fminf(toi, SweepImpact(a, a->body->origin, d, size / length, t0,
+                                   fminf(t1, toi), b));
+    }
+    if (toi >= 1)
       continue;
-    if (!EntityIsActive(ecs, other))
+
+    Vector2 offset = Vector2Scale(d, toi - 1);
+    a->transform->position = Vector2Add(a->transform->position, offset);
+    for (uint8_t k = 0; k < a->collider->vertices; k++)
+      a->collider->vx[k] = Vector2Add(a->collider->vx[k], offset);
+    a->collider->box.x += offset.x;
+    a->collider->box.y += offset.y;
+  }
+}
+
+// PIPELINE
+
+#define BROADPHASE_BATCH 64  ///< Sweep entries per broad-phase batch
+#define NARROWPHASE_BATCH 32 ///< Pairs per narrow-phase batch
+
+typedef struct {
+  ECS *ecs;
+  CollisionWorld *cw;
+  const Signature *layers; ///< Collision matrix of the registry
+} Pipeline;
+
+static int SweepCompare(const void *a, const void *b) {
+  const CollisionSweep *sa = a, *sb = b;
+  if (sa->min != sb->min)
+    return (sa->min > sb->min) - (sa->min < sb->min);
+  return (sa->body > sb->body) - (sa->body < sb->body);
+}
+
+static int PairCompare(const void *a, const void *b) {
+  const CollisionPair *pa = a, *pb = b;
+  uint32_t ka = PairKey(pa->ia, pa->ib), kb = PairKey(pb->ia, pb->ib);
+  return (ka > kb) - (ka < kb);
+}
+
+// Walks the sweep from entry k while the boxes overlap on the x axis. Counts
+// the pairs, or writes them from sweep[k].first when out is set.
+static size_t SweepPairs(Pipeline *p, size_t k, CollisionPair *out) {
+  CollisionWorld *cw = p->cw;
+  CollisionBody *a = &cw->bodies[cw->sweep[k].body];
+  size_t count = 0;
+  for (size_t j = k + 1;
+       j < cw->body_count && cw->sweep[j].min <= cw->sweep[k].max; j++) {
+    CollisionBody *b = &cw->bodies[cw->sweep[j].body];
+    if (!LayerMatrixIncludes(p->layers, a->layer, b->layer) ||
+        !BoxOverlap(a->collider->box, b->collider->box))
       continue;
+    if (out) {
+      Entity ia = cw->sweep[k].body, ib = cw->sweep[j].body;
+      CollisionPair pair = {ia < ib ? ia : ib, ia < ib ? ib : ia, false, false};
+      out[cw->sweep[k].first + count] = pair;
+    }
+    count++;
+  }
+  return count;
+}
+
+static void BroadphaseCount(void *ctx, size_t begin, size_t end) {
+  Pipeline *p = ctx;
+  for (size_t k = begin; k < end; k++)
+    p->cw->sweep[k].first = SweepPairs(p, k, NULL);
+}
+
+static void BroadphaseWrite(void *ctx, size_t begin, size_t end) {
+  Pipeline *p = ctx;
+  for (size_t k = begin; k < end; k++)
+    SweepPairs(p, k, p->cw->pairs);
+}
 
-    Transform2 *tb = GetComponent(ecs, other, Transform2);
-    Collider *cb = GetComponent(ecs, other, Collider);
-    RigidBody *rb = GetComponent(ecs, other, RigidBody);
-    uint8_t lb = EcsEntityData(ecs, other)->layer;
+// Sweep and prune on the x axis. Pairs are counted, then written at offsets
+// computed from the counts, and finally sorted by entity pair, so the output
+// doesn't depend on how batches were split between threads.
+static void Broadphase(Pipeline *p) {
+  CollisionWorld *cw = p->cw;
+  cw->sweep_alloc = MemEnsureCapacity((void **)&cw->sweep, cw->sweep_alloc,
+                                      cw->body_count, sizeof(CollisionSweep));
+  for (size_t i = 0; i < cw->body_count; i++) {
+    Rectangle box = cw->bodies[i].collider->box;
+    cw->sweep[i] = (CollisionSweep){box.x, box.x + box.width, i, 0};
+  }
+  if (cw->body_count > 1)
+    qsort(cw->sweep, cw->body_count, sizeof(CollisionSweep), SweepCompare);
+
+  JobParallelFor(cw->jobs, cw->body_count, BROADPHASE_BATCH, BroadphaseCount,
+                 p);
+  cw->pair_count = 0;
+  for (size_t k = 0; k < cw->body_count; k++) {
+    size_t count = cw->sweep[k].first;
+    cw->sweep[k].first = cw->pair_count;
+    cw->pair_count += count;
+  }
 
-    Collision collision;
-    uint8_t overlap =
-        LayerIncludes(ecs, la, lb) && CollisionSat(ta, ca, tb, cb, &collision);
-    if (overlap)
-      HandleCollisionEvents(ecs, self, other, &collision);
+  cw->pair_alloc = MemEnsureCapacity((void **)&cw->pairs, cw->pair_alloc,
+                                     cw->pair_count, sizeof(CollisionPair));
+  JobParallelFor(cw->jobs, cw->body_count, BROADPHASE_BATCH, BroadphaseWrite,
+                 p);
+  if (cw->pair_count > 1)
+    qsort(cw->pairs, cw->pair_count, sizeof(CollisionPair), PairCompare);
+}
+
+// Only reads the bodies: the contact of pair i is written to contacts[i].
+static void NarrowphasePair(CollisionWorld *cw, size_t i) {
+  CollisionPair *pair = &cw->pairs[i];
+  CollisionBody *a = &cw->bodies[pair->ia], *b = &cw->bodies[pair->ib];
+  Contact *cached = CachedContact(cw, a->entity, b->entity);
+  Contact *contact = &cw->contacts[i];
+  *contact = (Contact){a->entity, b->entity, {{0, 0}, 0}, 0, 0, 0, 0, 0, 0};
+  contact->ia = pair->ia;
+  contact->ib = pair->ib;
+
+  // resting pairs keep their last contact without narrow-phase
+  if (IsResting(a) && IsResting(b) && (IsAsleep(a) || IsAsleep(b))) {
+    if (!cached)
+      return;
+    contact->collision = cached->collision;
+    contact->impulse = cached->impulse;
+    pair->hit = true;
+    return;
+  }
+
+  if (!CollisionSat(a->transform, a->collider, b->transform, b->collider,
+                    &contact->collision))
+    return;
+  if (cached)
+    contact->impulse = cached->impulse;
+  pair->hit = true;
+
+  // something may have pushed into a sleeping body
+  pair->pushed = a->collider->solid && b->collider->solid &&
+                 (!cached || contact->collision.distance >
+                                 cached->collision.distance + SOLVER_SLOP);
+}
+
+static void NarrowphaseBatch(void *ctx, size_t begin, size_t end) {
+  Pipeline *p = ctx;
+  for (size_t i = begin; i < end; i++)
+    NarrowphasePair(p->cw, i);
+}
+
+// Contacts are compacted in pair order, then the bodies are updated serially.
+static void Narrowphase(Pipeline *p) {
+  CollisionWorld *cw = p->cw;
+  cw->alloc = MemEnsureCapacity((void **)&cw->contacts, cw->alloc,
+                                cw->pair_count, sizeof(Contact));
+  JobParallelFor(cw->jobs, cw->pair_count, NARROWPHASE_BATCH, NarrowphaseBatch,
+                 p);
+
+  cw->count = 0;
+  for (size_t i = 0; i < cw->pair_count; i++) {
+    CollisionPair *pair = &cw->pairs[i];
+    if (!pair->hit)
+      continue;
+    CollisionBody *a = &cw->bodies[pair->ia], *b = &cw->bodies[pair->ib];
+    a->collider->overlap = true;
+    b->collider->overlap = true;
+    Contact *contact = &cw->contacts[cw->count++];
+    *contact = cw->contacts[i];
+    contact->ga = EcsEntityData(p->ecs, a->entity)->generation;
+    contact->gb = EcsEntityData(p->ecs, b->entity)->generation;
+
+    if (pair->pushed && IsAsleep(a) && !IsAsleep(b))
+      WakeBody(a->body);
+    else if (pair->pushed && IsAsleep(b) && !IsAsleep(a))
+      WakeBody(b->body);
+  }
+}
+
+// Islands share no dynamic body, so each one is solved by a single thread.
+static void SolveBatch(void *ctx, size_t begin, size_t end) {
+  Pipeline *p = ctx;
+  for (size_t i = begin; i < end; i++)
+    SolveIsland(p->cw, &p->cw->islands[i]);
+}
 
-    ca->overlap |= overlap;
-    cb->overlap |= overlap;
-    overlap &= ca->solid && cb->solid;
+void CollisionSystem(ECS *ecs, Entity world) {
+  CollisionWorld *cw = GetComponent(ecs, world, CollisionWorld);
+  Pipeline pipeline = {ecs, cw, LayerMatrix(ecs)};
 
-    if (overlap)
-      ResolveCollision(&collision, ta, ra, tb, rb);
+  uint8_t threads = cw->threads ? cw->threads : 1;
+  // a pool that got fewer threads, or none, is kept until threads changes
+  if (cw->pooled != threads) {
+    JobPoolFree(cw->jobs);
+    cw->jobs = JobPoolCreate(threads);
+    cw->pooled = threads;
   }
+  double workers = JobPoolWorkerTime(cw->jobs);
+  JobPoolSetTrace(cw->jobs, EcsTrace(ecs));
+
+  // previous step contacts become the cache
+  Contact *swap = cw->cache;
+  cw->cache = cw->contacts;
+  cw->cached = cw->count;
+  cw->contacts = swap;
+  size_t alloc = cw->cache_alloc;
+  cw->cache_alloc = cw->alloc;
+  cw->alloc = alloc;
+  cw->count = 0;
+
+  GatherColliders(ecs, cw);
+  SweepBodies(ecs, cw);
+  Broadphase(&pipeline);
+  Narrowphase(&pipeline);
+
+  BuildIslands(cw);
+  WakeIslands(cw);
+  SortIslands(cw);
+  JobParallelFor(cw->jobs, cw->island_count, 1, SolveBatch, &pipeline);
+  SleepIslands(cw, EcsFixedDelta(ecs));
+  MarkMovedBodies(ecs, cw);
+  TagSleepingBodies(ecs, cw);
+  cw->cpu += JobPoolWorkerTime(cw->jobs) - workers;
+
+  BuildCollisionEvents(ecs, cw);
+  DispatchCollisionEvents(ecs, cw);
 }
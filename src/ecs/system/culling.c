@@ -0,0 +1,245 @@
+#include <ecs/component.h>
+#include <ecs/system.h>
+
+#include <mem/array.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CULL_LARGE 16 ///< Cells covered before a sprite goes to the large list
+
+// SPATIAL GRID
+
+static uint32_t CellHash(int32_t x, int32_t y) {
+  return (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u;
+}
+
+static RenderCell *CellFind(RenderView *rv, int32_t x, int32_t y) {
+  if (!rv->cell_alloc)
+    return NULL;
+  size_t mask = rv->cell_alloc - 1;
+  for (size_t i = CellHash(x, y) & mask;; i = (i + 1) & mask) {
+    RenderCell *cell = &rv->cells[i];
+    if (!cell->used)
+      return NULL;
+    if (cell->x == x && cell->y == y)
+      return cell;
+  }
+}
+
+static RenderCell *CellSlot(RenderCell *cells, size_t alloc, int32_t x,
+                            int32_t y) {
+  size_t mask = alloc - 1;
+  size_t i = CellHash(x, y) & mask;
+  while (cells[i].used && (cells[i].x != x || cells[i].y != y))
+    i = (i + 1) & mask;
+  return &cells[i];
+}
+
+// Cells are never removed: the grid only grows with the explored area.
+static RenderCell *CellInsert(RenderView *rv, int32_t x, int32_t y) {
+  if ((rv->cell_count + 1) * 2 > rv->cell_alloc) {
+    size_t alloc = rv->cell_alloc ? rv->cell_alloc * 2 : 64;
+    RenderCell *cells = calloc(alloc, sizeof(RenderCell));
+    if (!cells)
+      return NULL;
+    for (size_t i = 0; i < rv->cell_alloc; i++)
+      if (rv->cells[i].used)
+        *CellSlot(cells, alloc, rv->cells[i].x, rv->cells[i].y) =
+            rv->cells[i];
+    free(rv->cells);
+    rv->cells = cells;
+    rv->cell_alloc = alloc;
+  }
+
+  RenderCell *cell = CellSlot(rv->cells, rv->cell_alloc, x, y);
+  if (!cell->used) {
+    *cell = (RenderCell){x, y, true, NULL, 0, 0};
+    rv->cell_count++;
+  }
+  return cell;
+}
+
+static void CellPush(RenderCell *cell, Entity e) {
+  cell->alloc = MemPushBack((void **)&cell->entities, cell->alloc,
+                            cell->count++, &e, sizeof(Entity));
+}
+
+static void CellPop(RenderCell *cell, Entity e) {
+  for (uint32_t i = 0; cell && i < cell->count; i++) {
+    if (cell->entities[i] == e) {
+      cell->entities[i] = cell->entities[--cell->count];
+      return;
+    }
+  }
+}
+
+static bool IsLarge(RenderProxy *p) {
+  int64_t w = (int64_t)p->x1 - p->x0 + 1, h = (int64_t)p->y1 - p->y0 + 1;
+  return w * h > CULL_LARGE;
+}
+
+static void GridInsert(RenderView *rv, Entity e) {
+  RenderProxy *p = &rv->proxies[e];
+  if (IsLarge(p)) {
+    CellPush(&rv->large, e);
+    return;
+  }
+  for (int32_t y = p->y0; y <= p->y1; y++)
+    for (int32_t x = p->x0; x <= p->x1; x++) {
+      RenderCell *cell = CellInsert(rv, x, y);
+      if (cell)
+        CellPush(cell, e);
+    }
+}
+
+static void GridRemove(RenderView *rv, Entity e) {
+  RenderProxy *p = &rv->proxies[e];
+  if (IsLarge(p)) {
+    CellPop(&rv->large, e);
+    return;
+  }
+  for (int32_t y = p->y0; y <= p->y1; y++)
+    for (int32_t x = p->x0; x <= p->x1; x++)
+      CellPop(CellFind(rv, x, y), e);
+}
+
+// VISIBILITY
+
+static bool BoundsOverlap(Rectangle a, Rectangle b) {
+  return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+         a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+// Same rectangle as the one drawn by the SpriteSystem.
+static Rectangle SpriteBounds(Transform2 *t, Sprite *sp) {
+  float hw = fabsf(sp->src.width * t->scale.x) / 2;
+  float hh = fabsf(sp->src.height * t->scale.y) / 2;
+  float c = fabsf(cosf(t->rotation)), s = fabsf(sinf(t->rotation));
+  float ex = c * hw + s * hh, ey = s * hw + c * hh;
+  return (Rectangle){t->position.x - ex, t->position.y - ey, ex * 2, ey * 2};
+}
+
+static Rectangle CameraBounds(Camera2D *cam, Vector2 screen) {
+  Vector2 corners[4] = {{0, 0}, {screen.x, 0}, {0, screen.y}, screen};
+  Vector2 min = {INFINITY, INFINITY}, max = {-INFINITY, -INFINITY};
+  for (int i = 0; i < 4; i++) {
+    Vector2 p = GetScreenToWorld2D(corners[i], *cam);
+    min = Vector2Min(min, p);
+    max = Vector2Max(max, p);
+  }
+  return (Rectangle){min.x, min.y, max.x - min.x, max.y - min.y};
+}
+
+// Updates the bounds of every sprite, moving it in the grid only when it
+// covers other cells. New sprites start culled.
+static void RefreshSprites(ECS *ecs, RenderView *rv) {
+  Signature mask = EcsSignature(ecs, Transform2, Sprite);
+  Entity end = EcsEntityEnd(ecs);
+  size_t alloc = rv->proxy_alloc;
+  rv->proxy_alloc = MemEnsureCapacity((void **)&rv->proxies, rv->proxy_alloc,
+                                      end, sizeof(RenderProxy));
+  if (rv->proxy_alloc > alloc)
+    memset(&rv->proxies[alloc], 0,
+           (rv->proxy_alloc - alloc) * sizeof(RenderProxy));
+
+  float cell = rv->cell > 0 ? rv->cell : 256.f;
+  for (Entity e = 0; e < end; e++) {
+    RenderProxy *p = &rv->proxies[e];
+    if (!EcsHasComponents(ecs, e, mask)) {
+      if (p->indexed) {
+        GridRemove(rv, e);
+        p->indexed = false;
+        rv->indexed--;
+        EntitySetCulled(ecs, e, false);
+      }
+      continue;
+    }
+
+    Rectangle b = SpriteBounds(GetComponent(ecs, e, Transform2),
+                               GetComponent(ecs, e, Sprite));
+    RenderProxy moved = {b,
+                         (int32_t)floorf(b.x / cell),
+                         (int32_t)floorf(b.y / cell),
+                         (int32_t)floorf((b.x + b.width) / cell),
+                         (int32_t)floorf((b.y + b.height) / cell),
+                         p->stamp,
+                         true};
+    if (!p->indexed) {
+      *p = moved;
+      GridInsert(rv, e);
+      rv->indexed++;
+      EntitySetCulled(ecs, e, true);
+    } else if (moved.x0 != p->x0 || moved.y0 != p->y0 || moved.x1 != p->x1 ||
+               moved.y1 != p->y1) {
+      GridRemove(rv, e);
+      *p = moved;
+      GridInsert(rv, e);
+    } else {
+      p->bounds = b;
+    }
+  }
+}
+
+static void QueryCell(ECS *ecs, RenderView *rv, RenderCell *cell) {
+  for (uint32_t i = 0; cell && i < cell->count; i++) {
+    Entity e = cell->entities[i];
+    RenderProxy *p = &rv->proxies[e];
+    if (p->stamp == rv->frame)
+      continue;
+    p->stamp = rv->frame;
+    if (!BoundsOverlap(p->bounds, rv->view))
+      continue;
+    EntitySetCulled(ecs, e, false);
+    rv->list_alloc = MemPushBack((void **)&rv->list, rv->list_alloc,
+                                 rv->visible++, &e, sizeof(Entity));
+  }
+}
+
+static int EntityCompare(const void *a, const void *b) {
+  Entity ea = *(const Entity *)a, eb = *(const Entity *)b;
+  return (ea > eb) - (ea < eb);
+}
+
+void CullingSystem(ECS *ecs, Entity camera) {
+  RenderView *rv = GetComponent(ecs, camera, RenderView);
+  Camera2D *cam = GetComponent(ecs, camera, Camera2D);
+  rv->frame++;
+
+  Vector2 screen = rv->screen;
+  if (screen.x <= 0 || screen.y <= 0)
+    screen = (Vector2){GetScreenWidth(), GetScreenHeight()};
+  rv->view = CameraBounds(cam, screen);
+
+  RefreshSprites(ecs, rv);
+
+  // sprites visible on the previous frame are culled unless found again
+  Entity end = EcsEntityEnd(ecs);
+  for (size_t i = 0; i < rv->visible; i++)
+    if (rv->list[i] < end && rv->proxies[rv->list[i]].indexed)
+      EntitySetCulled(ecs, rv->list[i], true);
+  rv->visible = 0;
+
+  float cell = rv->cell > 0 ? rv->cell : 256.f;
+  int64_t x0 = (int64_t)floorf(rv->view.x / cell);
+  int64_t y0 = (int64_t)floorf(rv->view.y / cell);
+  int64_t x1 = (int64_t)floorf((rv->view.x + rv->view.width) / cell);
+  int64_t y1 = (int64_t)floorf((rv->view.y + rv->view.height) / cell);
+
+  // zoomed out views walk the grid instead of the covered cells
+  if ((x1 - x0 + 1) * (y1 - y0 + 1) > (int64_t)rv->cell_alloc) {
+    for (size_t i = 0; i < rv->cell_alloc; i++)
+      if (rv->cells[i].used && rv->cells[i].x >= x0 && rv->cells[i].x <= x1 &&
+          rv->cells[i].y >= y0 && rv->cells[i].y <= y1)
+        QueryCell(ecs, rv, &rv->cells[i]);
+  } else {
+    for (int64_t y = y0; y <= y1; y++)
+      for (int64_t x = x0; x <= x1; x++)
+        QueryCell(ecs, rv, CellFind(rv, (int32_t)x, (int32_t)y));
+  }
+  QueryCell(ecs, rv, &rv->large);
+
+  if (rv->visible > 1)
+    qsort(rv->list, rv->visible, sizeof(Entity), EntityCompare);
+  rv->culled = rv->indexed - rv->visible;
+}
@@ -4,20 +4,30 @@
 void PhysicsSystem(ECS *ecs, Entity e) {
   RigidBody *rb = GetComponent(ecs, e, RigidBody);
   Transform2 *t = GetComponent(ecs, e, Transform2);
+  if (rb->sleeping)
+    return;
+  if (rb->ccd)
+    rb->origin = t->position;
+  if (rb->speed.x != 0 || rb->speed.y != 0 || rb->acc.x != 0 ||
+      rb->acc.y != 0) {
+    MarkChanged(ecs, e, RigidBody);
+    MarkChanged(ecs, e, Transform2);
+  }
 
-  rb->speed.x += rb->acc.x * FIXED_DELTATIME;
-  rb->speed.y += rb->acc.y * FIXED_DELTATIME;
+  float dt = EcsFixedDelta(ecs);
+  rb->speed.x += rb->acc.x * dt;
+  rb->speed.y += rb->acc.y * dt;
 
-  t->position.x += rb->speed.x * FIXED_DELTATIME;
-  t->position.y += rb->speed.y * FIXED_DELTATIME;
+  t->position.x += rb->speed.x * dt;
+  t->position.y += rb->speed.y * dt;
 
   if (rb->damping > 0.f)
-    ApplyDamping(rb);
+    ApplyDamping(rb, dt);
 }
 
 void GravitySystem(ECS *ecs, Entity e) {
   RigidBody *rb = GetComponent(ecs, e, RigidBody);
-  if (!(rb->type == BodyDynamic && rb->gravity))
+  if (!(rb->type == BodyDynamic && rb->gravity) || rb->sleeping)
     return;
 
   Vector2 w = {0, 9.8f * rb->mass};
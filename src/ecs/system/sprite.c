@@ -1,14 +1,51 @@
 #include <ecs/component.h>
 #include <ecs/system.h>
 
-void SpriteSystem(ECS *ecs, Entity e) {
-  Transform2 *t = GetComponent(ecs, e, Transform2);
-  Sprite *sp = GetComponent(ecs, e, Sprite);
-
+static DrawCommand SpriteCommand(Transform2 *t, Sprite *sp) {
   float tw = sp->src.width * t->scale.x;
   float th = sp->src.height * t->scale.y;
   Rectangle dest = {t->position.x, t->position.y, tw, th};
   Vector2 origin = {tw / 2, th / 2};
-  DrawTexturePro(sp->tex, sp->src, dest, origin, t->rotation * RAD2DEG,
-                 sp->tint);
+  return (DrawCommand){sp->tex,  sp->src, dest, origin, t->rotation * RAD2DEG,
+                       sp->tint, 0,       0};
+}
+
+void RenderOrderSystem(ECS *ecs, Entity e) {
+  RenderOrder *order = GetComponent(ecs, e, RenderOrder);
+  Transform2 *t = GetComponent(ecs, e, Transform2);
+  float key = order->ysort ? t->position.y + order->z : order->z;
+  EntitySetSortKey(ecs, e, key);
+}
+
+void SpriteSystem(ECS *ecs, Entity e) {
+  DrawCommand c = SpriteCommand(GetComponent(ecs, e, Transform2),
+                                GetComponent(ecs, e, Sprite));
+  DrawTexturePro(c.tex, c.src, c.dest, c.origin, c.rotation, c.tint);
+}
+
+void SpriteBatchSystem(ECS *ecs, Entity camera) {
+  RenderView *rv = GetComponent(ecs, camera, RenderView);
+  RenderQueue *queue = GetComponent(ecs, camera, RenderQueue);
+  // both are optional: plain registries may not register them
+  Component fixed = EcsComponentID(ecs, "FixedClock");
+  Component lerp = EcsComponentID(ecs, "Interpolation");
+  FixedClock *clock =
+      fixed != InvalidID ? EcsGetComponent(ecs, camera, fixed) : NULL;
+
+  for (size_t i = 0; i < rv->visible; i++) {
+    Entity e = rv->list[i];
+    if (!EntityIsVisible(ecs, e))
+      continue;
+    Transform2 *t = GetComponent(ecs, e, Transform2);
+    Transform2 blended;
+    if (clock && lerp != InvalidID && EcsHasComponent(ecs, e, lerp)) {
+      blended = TransformInterpolate(t, EcsGetComponent(ecs, e, lerp),
+                                     clock->alpha);
+      t = &blended;
+    }
+    DrawCommand c = SpriteCommand(t, GetComponent(ecs, e, Sprite));
+    c.layer = EcsEntityData(ecs, e)->layer;
+    c.sort = EntitySortIndex(ecs, e);
+    RenderQueuePush(queue, c);
+  }
 }
@@ -7,8 +7,24 @@ void HierarchyTransformSystem(ECS *ecs, Entity e) {
   Transform2 *tp = GetComponent(ecs, p->entity, Transform2);
   if (!tp)
     return;
-  t->position = Vector2Add(tp->position, t->localPosition);
-  t->scale =
-      (Vector2){tp->scale.x * t->localScale.x, tp->scale.y * t->localScale.y};
-  t->rotation = tp->rotation + t->localRotation;
+  Vector2 position = Vector2Add(tp->position, t->localPosition);
+  Vector2 scale = {tp->scale.x * t->localScale.x,
+                   tp->scale.y * t->localScale.y};
+  float rotation = tp->rotation + t->localRotation;
+  // unchanged children aren't marked
+  if (position.x == t->position.x && position.y == t->position.y &&
+      scale.x == t->scale.x && scale.y == t->scale.y &&
+      rotation == t->rotation)
+    return;
+  t->position = position;
+  t->scale = scale;
+  t->rotation = rotation;
+  MarkChanged(ecs, e, Transform2);
+}
+
+void InterpolationSystem(ECS *ecs, Entity e) {
+  Interpolation *prev = GetComponent(ecs, e, Interpolation);
+  Transform2 *t = GetComponent(ecs, e, Transform2);
+  prev->position = t->position;
+  prev->rotation = t->rotation;
 }
@@ -4,70 +4,182 @@
 #include <emscripten/emscripten.h>
 #endif
 
-static float fixed_time; ///< Accumulator for fixed timestep integration
-static Color background; ///< Window background color
+// Screen of headless worlds, which never call the window: their sprites are
+// culled and recorded as if drawn in a window of this size.
+#define HEADLESS_SCREEN ((Vector2){800, 450})
 
-ECS *EcsWorld(void) {
+static ECS *WorldCreate(bool headless) {
   ECS *ecs = EcsRegistry();
 
   Component(ecs, Transform2);
+  Component(ecs, Interpolation);
+  Component(ecs, FixedClock);
   Component(ecs, Behaviour);
   Component(ecs, Parent);
   ComponentDynamic(ecs, Children, ChildrenDestructor);
   Component(ecs, Camera2D);
   Component(ecs, Sprite);
+  Component(ecs, RenderOrder);
+  ComponentDynamic(ecs, RenderView, RenderViewDestructor);
+  ComponentDynamic(ecs, RenderQueue, RenderQueueDestructor);
   ComponentDynamic(ecs, Collider, ColliderDestructor);
   Component(ecs, CollisionListener);
+  ComponentDynamic(ecs, CollisionWorld, CollisionWorldDestructor);
   Component(ecs, RigidBody);
+  ComponentTag(ecs, Sleeping);
+
+  ComponentSerialize(ecs, Children, ChildrenSave, ChildrenLoad);
+  ComponentSerialize(ecs, RenderView, NULL, RenderViewLoad);
+  ComponentSerialize(ecs, RenderQueue, NULL, RenderQueueLoad);
+  ComponentSerialize(ecs, Collider, ColliderSave, ColliderLoad);
+  ComponentSerialize(ecs, CollisionWorld, CollisionWorldSave,
+                     CollisionWorldLoad);
+  ComponentRollback(ecs, CollisionWorld, CollisionWorldRestore);
+  ComponentDelta(ecs, Transform2, TransformEncode, TransformDecode);
+  ComponentHash(ecs, Collider, ColliderHash);
+  ComponentHash(ecs, RigidBody, RigidBodyHash);
 
-  Camera2D camera = {
-      .offset = {GetScreenWidth() / 2.f, GetScreenHeight() / 2.f},
-      .target = {0, 0},
-      .rotation = 0,
-      .zoom = 1.f};
+  AddLayer(ecs, "default");
+
+  Vector2 screen = HEADLESS_SCREEN;
+  if (!headless)
+    screen = (Vector2){GetScreenWidth(), GetScreenHeight()};
+  Camera2D camera = {.offset = {screen.x / 2, screen.y / 2},
+                     .target = {0, 0},
+                     .rotation = 0,
+                     .zoom = 1.f};
+  RenderView view = RenderViewDefault;
+  if (headless)
+    view.screen = screen;
   Entity camEntity = EcsEntity(ecs, "MainCamera");
   AddComponent(ecs, camEntity, Camera2D, camera);
+  AddComponent(ecs, camEntity, CollisionWorld, CollisionWorldDefault);
+  AddComponent(ecs, camEntity, RenderView, view);
+  AddComponent(ecs, camEntity, RenderQueue, RenderQueueCreate(headless));
+  AddComponent(ecs, camEntity, FixedClock, FixedClockDefault);
 
   System(ecs, BehaviourStartSystem, EcsOnStart, Behaviour);
   System(ecs, BehaviourUpdateSystem, EcsOnUpdate, Behaviour);
   System(ecs, BehaviourLateSystem, EcsOnLateUpdate, Behaviour);
   System(ecs, BehaviourFixedSystem, EcsOnFixedUpdate, Behaviour);
-  System(ecs, BehaviourRenderSystem, EcsOnRender, Behaviour);
-  System(ecs, BehaviourGuiSystem, EcsOnGui, Behaviour);
+  if (!headless) {
+    System(ecs, BehaviourRenderSystem, EcsOnRender, Behaviour);
+    System(ecs, BehaviourGuiSystem, EcsOnGui, Behaviour);
+  }
 
   System(ecs, HierarchyTransformSystem, EcsOnUpdate, Transform2, Parent);
-  System(ecs, TransformColliderSystem, EcsOnUpdate, Transform2, Collider);
-  System(ecs, CollisionSystem, EcsOnUpdate, Transform2, Collider);
 
-  System(ecs, GravitySystem, EcsOnFixedUpdate, RigidBody);
-  System(ecs, PhysicsSystem, EcsOnFixedUpdate, RigidBody, Transform2);
+  System(ecs, InterpolationSystem, EcsOnFixedUpdate, Transform2, Interpolation);
+  SystemQuery(ecs, GravitySystem, EcsOnFixedUpdate,
+              .with = EcsSignature(ecs, RigidBody),
+              .without = EcsSignature(ecs, Sleeping));
+  SystemQuery(ecs, PhysicsSystem, EcsOnFixedUpdate,
+              .with = EcsSignature(ecs, RigidBody, Transform2),
+              .without = EcsSignature(ecs, Sleeping));
+  System(ecs, TransformColliderSystem, EcsOnFixedUpdate, Transform2, Collider);
+  System(ecs, CollisionSystem, EcsOnFixedUpdate, CollisionWorld);
 
-  System(ecs, SpriteSystem, EcsOnRender, Transform2, Sprite);
-
-  AddLayer(ecs, "default");
+  System(ecs, RenderOrderSystem, EcsOnPreRender, Transform2, RenderOrder);
+  System(ecs, CullingSystem, EcsOnPreRender, Camera2D, RenderView);
+  System(ecs, SpriteBatchSystem, EcsOnRender, RenderView, RenderQueue);
 
-  background = (Color){23, 28, 29, 255};
   return ecs;
 }
 
+ECS *EcsWorld(void) { return WorldCreate(false); }
+
+ECS *EcsWorldHeadless(void) { return WorldCreate(true); }
+
+// CPU time of the collision workers, which the step thread doesn't count.
+static double StepWorkers(ECS *world) {
+  if (ComponentID(world, CollisionWorld) == InvalidID ||
+      EcsEntityEnd(world) == 0 || !WorldCollisions(world))
+    return 0;
+  return WorldCollisions(world)->cpu;
+}
+
+// Registries not created by EcsWorld() may have no clock, or no entity 0.
+static FixedClock *StepClock(ECS *world) {
+  if (ComponentID(world, FixedClock) == InvalidID || EcsEntityEnd(world) == 0)
+    return NULL;
+  return WorldClock(world);
+}
+
+void EcsStep(ECS *world, float dt) {
+  EcsProfileFrame(world);
+  TraceFrame(EcsTrace(world));
+  double step = TraceBegin(EcsTrace(world));
+  double start = JobThreadTime(), workers = StepWorkers(world);
+  EcsRunSystems(world, EcsOnUpdate);
+  EcsRunSystems(world, EcsOnLateUpdate);
+
+  FixedClock *clock = StepClock(world);
+  if (!clock) {
+    EcsStepFixed(world, 1);
+    TraceEnd(EcsTrace(world), "Step", "step", step);
+    return;
+  }
+  float fixed = EcsFixedDelta(world);
+  clock->accumulator += dt;
+  clock->steps = 0;
+  while (clock->accumulator >= fixed) {
+    // drop the time left after a hitch instead of falling behind
+    if (clock->max_steps && clock->steps == clock->max_steps) {
+      float late = clock->accumulator - fmodf(clock->accumulator, fixed);
+      clock->dropped += late;
+      clock->accumulator -= late;
+      break;
+    }
+    double substep = TraceBegin(EcsTrace(world));
+    EcsRunSystems(world, EcsOnFixedUpdate);
+    TraceEnd(EcsTrace(world), "FixedStep", "step", substep);
+    clock->accumulator -= fixed;
+    clock->steps++;
+  }
+  clock->alpha = clock->accumulator / fixed;
+  clock->cpu = JobThreadTime() - start + StepWorkers(world) - workers;
+  clock->cpu_total += clock->cpu;
+  TraceEnd(EcsTrace(world), "Step", "step", step);
+}
+
+void EcsStepFixed(ECS *world, uint32_t steps) {
+  for (uint32_t i = 0; i < steps; i++) {
+    double substep = TraceBegin(EcsTrace(world));
+    EcsRunSystems(world, EcsOnFixedUpdate);
+    TraceEnd(EcsTrace(world), "FixedStep", "step", substep);
+  }
+}
+
+typedef struct {
+  ECS **worlds;
+  float dt;
+} StepBatch;
+
+static void StepWorlds(void *ctx, size_t begin, size_t end) {
+  StepBatch *batch = (StepBatch *)ctx;
+  for (size_t i = begin; i < end; i++)
+    EcsStep(batch->worlds[i], batch->dt);
+}
+
+void EcsStepWorlds(ECS **worlds, size_t count, float dt, JobPool *pool) {
+  StepBatch batch = {worlds, dt};
+  JobParallelFor(pool, count, 1, StepWorlds, &batch);
+}
+
 void GameGenericLoop(void *world) {
   ECS *ecs = (ECS *)world;
 
-  EcsRunSystems(ecs, EcsOnUpdate);
-  EcsRunSystems(ecs, EcsOnLateUpdate);
+  EcsStep(ecs, GetFrameTime());
 
-  fixed_time += GetFrameTime();
-  while (fixed_time >= FIXED_DELTATIME) {
-    EcsRunSystems(ecs, EcsOnFixedUpdate);
-    fixed_time -= FIXED_DELTATIME;
-  }
+  EcsRunSystems(ecs, EcsOnPreRender);
 
   BeginDrawing();
-  ClearBackground(background);
+  ClearBackground(WorldView(ecs)->background);
 
   Camera2D *cam = WorldMainCamera(ecs);
   BeginMode2D(*cam);
   EcsRunSystems(ecs, EcsOnRender);
+  RenderQueueFlush(WorldQueue(ecs));
   EndMode2D();
 
   EcsRunSystems(ecs, EcsOnGui);
@@ -87,4 +199,21 @@ void EcsLoop(ECS *world) {
 #endif
 }
 
+uint64_t WorldStateHash(ECS *world) {
+  return EcsStateHash(world,
+                      EcsSignature(world, Transform2, RigidBody, Collider));
+}
+
 Camera2D *WorldMainCamera(ECS *ecs) { return GetComponent(ecs, 0, Camera2D); }
+
+CollisionWorld *WorldCollisions(ECS *ecs) {
+  return GetComponent(ecs, 0, CollisionWorld);
+}
+
+RenderView *WorldView(ECS *ecs) { return GetComponent(ecs, 0, RenderView); }
+
+RenderQueue *WorldQueue(ECS *ecs) {
+  return GetComponent(ecs, 0, RenderQueue);
+}
+
+FixedClock *WorldClock(ECS *ecs) { return GetComponent(ecs, 0, FixedClock); }
@@ -0,0 +1,135 @@
+#include <mem/intern.h>
+
+#include <mem/array.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_BLOCK 4096 ///< Minimum arena block size
+
+struct StringBlock {
+  StringBlock *next;
+  size_t used;
+  size_t size;
+  char data[];
+};
+
+uint32_t StringHash(const char *str, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++)
+    hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+  return hash;
+}
+
+void StringTableInit(StringTable *table) {
+  table->entries = NULL;
+  table->count = 0;
+  table->alloc = 0;
+  table->index = NULL;
+  table->index_alloc = 0;
+  table->blocks = NULL;
+}
+
+void StringTableFree(StringTable *table) {
+  while (table->blocks) {
+    StringBlock *next = table->blocks->next;
+    free(table->blocks);
+    table->blocks = next;
+  }
+  free(table->entries);
+  free(table->index);
+  StringTableInit(table);
+}
+
+static StringID *StringSlot(StringID *index, size_t alloc,
+                            const StringEntry *entries, const char *str,
+                            size_t len, uint32_t hash) {
+  size_t mask = alloc - 1;
+  size_t i = hash & mask;
+  for (; index[i] != InvalidString; i = (i + 1) & mask) {
+    const StringEntry *e = &entries[index[i]];
+    if (e->hash == hash && e->len == len && memcmp(e->str, str, len) == 0)
+      break;
+  }
+  return &index[i];
+}
+
+StringID StringFindN(const StringTable *table, const char *str, size_t len) {
+  if (!str || !table->index_alloc)
+    return InvalidString;
+  return *StringSlot(table->index, table->index_alloc, table->entries, str,
+                     len, StringHash(str, len));
+}
+
+StringID StringFind(const StringTable *table, const char *str) {
+  return str ? StringFindN(table, str, strlen(str)) : InvalidString;
+}
+
+// Copies a string at the end of the newest block, or in a new one.
+static const char *StringCopy(StringTable *table, const char *str,
+                              size_t len) {
+  StringBlock *block = table->blocks;
+  if (!block || block->size - block->used < len + 1) {
+    size_t size = len + 1 > STRING_BLOCK ? len + 1 : STRING_BLOCK;
+    block = malloc(sizeof(StringBlock) + size);
+    if (!block)
+      return NULL;
+    block->next = table->blocks;
+    block->used = 0;
+    block->size = size;
+    table->blocks = block;
+  }
+  char *copy = block->data + block->used;
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  block->used += len + 1;
+  return copy;
+}
+
+// Keeps the index at most half full.
+static int StringGrowIndex(StringTable *table) {
+  if (((size_t)table->count + 1) * 2 <= table->index_alloc)
+    return 1;
+  size_t alloc = table->index_alloc ? table->index_alloc * 2 : 64;
+  StringID *index = malloc(alloc * sizeof(StringID));
+  if (!index)
+    return 0;
+  memset(index, 0xFF, alloc * sizeof(StringID)); // InvalidString
+  for (StringID i = 0; i < table->count; i++) {
+    StringEntry *e = &table->entries[i];
+    *StringSlot(index, alloc, table->entries, e->str, e->len, e->hash) = i;
+  }
+  free(table->index);
+  table->index = index;
+  table->index_alloc = alloc;
+  return 1;
+}
+
+StringID StringInternN(StringTable *table, const char *str, size_t len) {
+  StringID found = StringFindN(table, str, len);
+  if (found != InvalidString)
+    return found;
+  if (!str || table->count >= InvalidString - 1 || !StringGrowIndex(table))
+    return InvalidString;
+
+  StringEntry entry = {StringCopy(table, str, len), StringHash(str, len),
+                       (uint32_t)len};
+  if (!entry.str)
+    return InvalidString;
+  size_t alloc = MemPushBack((void **)&table->entries, table->alloc,
+                             table->count, &entry, sizeof(StringEntry));
+  if (!alloc)
+    return InvalidString;
+  table->alloc = (StringID)alloc;
+  *StringSlot(table->index, table->index_alloc, table->entries, str, len,
+              entry.hash) = table->count;
+  return table->count++;
+}
+
+StringID StringIntern(StringTable *table, const char *str) {
+  return str ? StringInternN(table, str, strlen(str)) : InvalidString;
+}
+
+const char *StringGet(const StringTable *table, StringID id) {
+  return id < table->count ? table->entries[id].str : NULL;
+}
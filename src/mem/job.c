@@ -0,0 +1,271 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+#endif
+
+#include <mem/job.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+double JobThreadTime(void) {
+  FILETIME create, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user))
+    return 0;
+  ULARGE_INTEGER k = {{kernel.dwLowDateTime, kernel.dwHighDateTime}};
+  ULARGE_INTEGER u = {{user.dwLowDateTime, user.dwHighDateTime}};
+  return (double)(k.QuadPart + u.QuadPart) * 1e-7; // 100ns units
+}
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+double JobThreadTime(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    return 0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#else
+double JobThreadTime(void) { return (double)clock() / CLOCKS_PER_SEC; }
+#endif
+
+#if defined(GEARECS_NO_THREADS)
+
+JobPool *JobPoolCreate(uint8_t threads) {
+  (void)threads;
+  return NULL;
+}
+
+void JobPoolFree(JobPool *pool) { (void)pool; }
+
+uint8_t JobPoolThreads(JobPool *pool) {
+  (void)pool;
+  return 1;
+}
+
+double JobPoolWorkerTime(JobPool *pool) {
+  (void)pool;
+  return 0;
+}
+
+void JobPoolSetTrace(JobPool *pool, Trace *trace) {
+  (void)pool;
+  (void)trace;
+}
+
+void JobParallelFor(JobPool *pool, size_t count, size_t batch, JobTask task,
+                    void *ctx) {
+  (void)pool;
+  if (batch == 0)
+    batch = 1;
+  for (size_t begin = 0; begin < count; begin += batch)
+    task(ctx, begin, begin + batch < count ? begin + batch : count);
+}
+
+#else
+
+#if defined(_WIN32)
+typedef HANDLE JobThread;
+typedef CRITICAL_SECTION JobMutex;
+typedef CONDITION_VARIABLE JobCond;
+
+#define JobMutexInit(m) InitializeCriticalSection(m)
+#define JobMutexFree(m) DeleteCriticalSection(m)
+#define JobLock(m) EnterCriticalSection(m)
+#define JobUnlock(m) LeaveCriticalSection(m)
+#define JobCondInit(c) InitializeConditionVariable(c)
+#define JobCondFree(c) ((void)(c))
+#define JobWait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define JobSignal(c) WakeConditionVariable(c)
+#define JobBroadcast(c) WakeAllConditionVariable(c)
+#else
+#include <pthread.h>
+
+typedef pthread_t JobThread;
+typedef pthread_mutex_t JobMutex;
+typedef pthread_cond_t JobCond;
+
+#define JobMutexInit(m) pthread_mutex_init(m, NULL)
+#define JobMutexFree(m) pthread_mutex_destroy(m)
+#define JobLock(m) pthread_mutex_lock(m)
+#define JobUnlock(m) pthread_mutex_unlock(m)
+#define JobCondInit(c) pthread_cond_init(c, NULL)
+#define JobCondFree(c) pthread_cond_destroy(c)
+#define JobWait(c, m) pthread_cond_wait(c, m)
+#define JobSignal(c) pthread_cond_signal(c)
+#define JobBroadcast(c) pthread_cond_broadcast(c)
+#endif
+
+struct JobPool {
+  JobThread *workers; ///< Worker threads (threads - 1)
+  uint8_t threads;    ///< Threads running the loops, including the caller
+  JobMutex lock;      ///< Protects every field below
+  JobCond work;       ///< Signaled when a loop is submitted or on stop
+  JobCond done;       ///< Signaled when the last batch finishes
+  JobTask task;       ///< Task of the current loop, NULL when idle
+  void *ctx;          ///< Context of the current loop
+  size_t count;       ///< Number of indices of the current loop
+  size_t batch;       ///< Indices per batch
+  size_t next;        ///< Next batch to claim
+  size_t batches;     ///< Number of batches of the current loop
+  size_t pending;     ///< Batches not finished yet
+  uint8_t stop;       ///< Workers must exit
+  Trace *trace;       ///< Trace recording the batches, NULL if none
+  double worker_time; ///< CPU time spent by the workers (seconds)
+};
+
+// Runs claimed batches until none is left. Called with the lock held.
+static void JobDrain(JobPool *pool) {
+  while (pool->task && pool->next < pool->batches) {
+    size_t begin = pool->next++ * pool->batch;
+    size_t end = begin + pool->batch;
+    if (end > pool->count)
+      end = pool->count;
+    JobTask task = pool->task;
+    void *ctx = pool->ctx;
+    Trace *trace = pool->trace;
+
+    JobUnlock(&pool->lock);
+    double start = TraceBegin(trace);
+    task(ctx, begin, end);
+    TraceEnd(trace, "Job", "job", start);
+    JobLock(&pool->lock);
+
+    if (--pool->pending == 0)
+      JobSignal(&pool->done);
+  }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI JobWorker(LPVOID arg) {
+#else
+static void *JobWorker(void *arg) {
+#endif
+  JobPool *pool = (JobPool *)arg;
+  JobLock(&pool->lock);
+  while (!pool->stop) {
+    double start = JobThreadTime();
+    JobDrain(pool);
+    pool->worker_time += JobThreadTime() - start;
+    if (!pool->stop)
+      JobWait(&pool->work, &pool->lock);
+  }
+  JobUnlock(&pool->lock);
+  return 0;
+}
+
+JobPool *JobPoolCreate(uint8_t threads) {
+  if (threads <= 1)
+    return NULL;
+
+  JobPool *pool = (JobPool *)calloc(1, sizeof(JobPool));
+  if (!pool)
+    return NULL;
+  pool->workers = (JobThread *)calloc(threads - 1, sizeof(JobThread));
+  if (!pool->workers) {
+    free(pool);
+    return NULL;
+  }
+  JobMutexInit(&pool->lock);
+  JobCondInit(&pool->work);
+  JobCondInit(&pool->done);
+
+  pool->threads = 1;
+  for (uint8_t i = 0; i < threads - 1; i++) {
+#if defined(_WIN32)
+    pool->workers[i] = CreateThread(NULL, 0, JobWorker, pool, 0, NULL);
+    if (!pool->workers[i])
+      break;
+#else
+    if (pthread_create(&pool->workers[i], NULL, JobWorker, pool) != 0)
+      break;
+#endif
+    pool->threads++;
+  }
+
+  if (pool->threads == 1) {
+    JobPoolFree(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void JobPoolFree(JobPool *pool) {
+  if (!pool)
+    return;
+
+  JobLock(&pool->lock);
+  pool->stop = 1;
+  JobBroadcast(&pool->work);
+  JobUnlock(&pool->lock);
+
+  for (uint8_t i = 0; i < pool->threads - 1; i++) {
+#if defined(_WIN32)
+    WaitForSingleObject(pool->workers[i], INFINITE);
+    CloseHandle(pool->workers[i]);
+#else
+    pthread_join(pool->workers[i], NULL);
+#endif
+  }
+
+  JobCondFree(&pool->done);
+  JobCondFree(&pool->work);
+  JobMutexFree(&pool->lock);
+  free(pool->workers);
+  free(pool);
+}
+
+uint8_t JobPoolThreads(JobPool *pool) { return pool ? pool->threads : 1; }
+
+double JobPoolWorkerTime(JobPool *pool) {
+  if (!pool)
+    return 0;
+  JobLock(&pool->lock);
+  double time = pool->worker_time;
+  JobUnlock(&pool->lock);
+  return time;
+}
+
+void JobPoolSetTrace(JobPool *pool, Trace *trace) {
+  if (!pool)
+    return;
+  JobLock(&pool->lock);
+  pool->trace = trace;
+  JobUnlock(&pool->lock);
+}
+
+void JobParallelFor(JobPool *pool, size_t count, size_t batch, JobTask task,
+                    void *ctx) {
+  if (batch == 0)
+    batch = 1;
+  if (!pool || count <= batch) {
+    for (size_t begin = 0; begin < count; begin += batch)
+      task(ctx, begin, begin + batch < count ? begin + batch : count);
+    return;
+  }
+
+  JobLock(&pool->lock);
+  // a task of the running loop (or another thread) submitted this one
+  if (pool->task) {
+    JobUnlock(&pool->lock);
+    JobParallelFor(NULL, count, batch, task, ctx);
+    return;
+  }
+  pool->task = task;
+  pool->ctx = ctx;
+  pool->count = count;
+  pool->batch = batch;
+  pool->next = 0;
+  pool->batches = (count + batch - 1) / batch;
+  pool->pending = pool->batches;
+  JobBroadcast(&pool->work);
+
+  JobDrain(pool);
+  while (pool->pending)
+    JobWait(&pool->done, &pool->lock);
+  pool->task = NULL;
+  JobUnlock(&pool->lock);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include <mem/simmath.h>
+
+#if defined(GEARECS_DETERMINISTIC)
+
+#include <float.h>
+#include <stdint.h>
+
+#if FLT_EVAL_METHOD != 0
+#error "GEARECS_DETERMINISTIC needs float math without extended precision"
+#endif
+
+// Kernels are evaluated in double, then rounded once to float. Coefficients
+// are the minimax polynomials of musl's __sindf and __cosdf.
+
+#define PIO2_HI 1.57079631090164184570e+00 // first 33 bits of pi/2
+#define PIO2_LO 1.58932547735281966916e-08 // pi/2 - PIO2_HI
+#define INV_PIO2 6.36619772367581382433e-01
+#define TWO_PI 6.28318530717958647693
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define INV_LN2 1.44269504088896338700e+00
+
+// sin(x) for |x| <= pi/4
+static double KernelSin(double x) {
+  double z = x * x, w = z * z, s = z * x;
+  double r = -1.98393348360966317347e-04 + z * 2.71831149398982190640e-06;
+  return (x + s * (-1.66666666416265235595e-01 +
+                   z * 8.33332938588946317560e-03)) +
+         s * w * r;
+}
+
+// cos(x) for |x| <= pi/4
+static double KernelCos(double x) {
+  double z = x * x, w = z * z;
+  double r = -1.38867637746099294692e-03 + z * 2.43904487962774090654e-05;
+  return ((1.0 + z * -4.99999997251031003120e-01) +
+          w * 4.16666233237390631894e-02) +
+         (w * z) * r;
+}
+
+// Reduces x to r in [-pi/4, pi/4] and returns the quadrant of x.
+static unsigned Reduce(float x, double *r) {
+  double y = x;
+  if (fabs(y) > 65536.0)
+    y = fmod(y, TWO_PI); // exact, only loses the precision of TWO_PI
+  double n = floor(y * INV_PIO2 + 0.5);
+  *r = (y - n * PIO2_HI) - n * PIO2_LO;
+  return (unsigned)(int64_t)n & 3u;
+}
+
+float SimSinf(float x) {
+  if (isnan(x) || isinf(x))
+    return x - x;
+  double r;
+  switch (Reduce(x, &r)) {
+  case 0:
+    return (float)KernelSin(r);
+  case 1:
+    return (float)KernelCos(r);
+  case 2:
+    return (float)-KernelSin(r);
+  default:
+    return (float)-KernelCos(r);
+  }
+}
+
+float SimCosf(float x) {
+  if (isnan(x) || isinf(x))
+    return x - x;
+  double r;
+  switch (Reduce(x, &r)) {
+  case 0:
+    return (float)KernelCos(r);
+  case 1:
+    return (float)-KernelSin(r);
+  case 2:
+    return (float)-KernelCos(r);
+  default:
+    return (float)KernelSin(r);
+  }
+}
+
+// e^x = 2^k * e^r, with |r| <= ln2/2 and e^r from its Taylor series
+float SimExpf(float x) {
+  if (isnan(x))
+    return x;
+  if (x > 88.8f)
+    return INFINITY;
+  if (x < -104.0f)
+    return 0;
+  double k = floor(x * INV_LN2 + 0.5);
+  double r = ((double)x - k * LN2_HI) - k * LN2_LO;
+  double p = 1.0 / 40320;
+  p = 1.0 / 5040 + r * p;
+  p = 1.0 / 720 + r * p;
+  p = 1.0 / 120 + r * p;
+  p = 1.0 / 24 + r * p;
+  p = 1.0 / 6 + r * p;
+  p = 0.5 + r * p;
+  p = 1.0 + r * p;
+  p = 1.0 + r * p;
+  return (float)ldexp(p, (int)k);
+}
+
+#else
+
+typedef int SimMathUnused; // ISO C forbids an empty translation unit
+
+#endif
@@ -0,0 +1,250 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // fileno
+#endif
+
+#include <mem/stream.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STREAM_MMAP
+#endif
+
+// Grows the stream to hold n more bytes.
+static bool StreamReserve(Stream *s, size_t n) {
+  if (s->failed || s->mapped) {
+    s->failed = true;
+    return false;
+  }
+  if (s->size + n > s->alloc) {
+    size_t alloc = s->alloc ? s->alloc : 256;
+    while (alloc < s->size + n)
+      alloc *= 2;
+    uint8_t *data = realloc(s->data, alloc);
+    if (!data) {
+      s->failed = true;
+      return false;
+    }
+    s->data = data;
+    s->alloc = alloc;
+  }
+  return true;
+}
+
+bool StreamWrite(Stream *s, const void *src, size_t n) {
+  if (!StreamReserve(s, n))
+    return false;
+  if (n > 0)
+    memcpy(s->data + s->size, src, n);
+  s->size += n;
+  return true;
+}
+
+bool StreamPrintf(Stream *s, const char *format, ...) {
+  va_list args, copy;
+  va_start(args, format);
+  va_copy(copy, args);
+  int n = vsnprintf(NULL, 0, format, copy);
+  va_end(copy);
+  if (n < 0 || !StreamReserve(s, (size_t)n + 1)) {
+    s->failed = true;
+    va_end(args);
+    return false;
+  }
+  vsnprintf((char *)s->data + s->size, (size_t)n + 1, format, args);
+  va_end(args);
+  s->size += (size_t)n;
+  return true;
+}
+
+bool StreamPrintJson(Stream *s, const char *text) {
+  StreamWrite(s, "\"", 1);
+  while (text && *text) {
+    size_t n = 0; // plain bytes are copied in runs
+    while (text[n] && text[n] != '"' && text[n] != '\\' &&
+           (unsigned char)text[n] >= 0x20)
+      n++;
+    StreamWrite(s, text, n);
+    text += n;
+    if (!*text)
+      break;
+    unsigned char c = (unsigned char)*text++;
+    if (c == '"' || c == '\\')
+      StreamPrintf(s, "\\%c", c);
+    else
+      StreamPrintf(s, "\\u%04x", c);
+  }
+  StreamWrite(s, "\"", 1);
+  return !s->failed;
+}
+
+const void *StreamView(Stream *s, size_t n) {
+  if (s->failed || n > s->size - s->pos) {
+    s->failed = true;
+    return NULL;
+  }
+  const void *view = s->data + s->pos;
+  s->pos += n;
+  return view;
+}
+
+bool StreamRead(Stream *s, void *dest, size_t n) {
+  const void *src = StreamView(s, n);
+  if (!src) {
+    memset(dest, 0, n);
+    return false;
+  }
+  if (n > 0)
+    memcpy(dest, src, n);
+  return true;
+}
+
+bool StreamWriteVarint(Stream *s, uint64_t value) {
+  uint8_t bytes[10];
+  size_t n = 0;
+  do {
+    bytes[n] = value & 0x7F;
+    value >>= 7;
+    if (value)
+      bytes[n] |= 0x80;
+    n++;
+  } while (value);
+  return StreamWrite(s, bytes, n);
+}
+
+uint64_t StreamReadVarint(Stream *s) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    const uint8_t *byte = StreamView(s, 1);
+    if (!byte)
+      return 0;
+    value |= (uint64_t)(*byte & 0x7F) << shift;
+    if (!(*byte & 0x80))
+      return value;
+  }
+  s->failed = true; // more than 10 bytes
+  return 0;
+}
+
+// Zigzag: small negative values are small unsigned values too.
+bool StreamWriteQuantized(Stream *s, float value, float step) {
+  double q = round((double)value / step);
+  int64_t i = isfinite(q) && fabs(q) < 9e18 ? (int64_t)q : 0;
+  return StreamWriteVarint(s, ((uint64_t)i << 1) ^ (uint64_t)(i >> 63));
+}
+
+float StreamReadQuantized(Stream *s, float step) {
+  uint64_t z = StreamReadVarint(s);
+  int64_t i = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+  return (float)((double)i * step);
+}
+
+void StreamPad(Stream *s, size_t align) {
+  static const uint8_t zeros[16] = {0};
+  size_t pad = (align - s->size % align) % align;
+  while (pad > 0) {
+    size_t n = pad < sizeof(zeros) ? pad : sizeof(zeros);
+    StreamWrite(s, zeros, n);
+    pad -= n;
+  }
+}
+
+void StreamAlign(Stream *s, size_t align) {
+  StreamView(s, (align - s->pos % align) % align);
+}
+
+void StreamFree(Stream *s) {
+#if defined(_WIN32)
+  if (s->mapped)
+    UnmapViewOfFile(s->data);
+#elif defined(STREAM_MMAP)
+  if (s->mapped)
+    munmap(s->data, s->size);
+#endif
+  if (s->alloc)
+    free(s->data);
+  *s = (Stream){0};
+}
+
+bool StreamSave(Stream *s, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+  bool ok = fwrite(s->data, 1, s->size, file) == s->size;
+  return fclose(file) == 0 && ok;
+}
+
+bool StreamLoad(Stream *s, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  long size = -1;
+  if (fseek(file, 0, SEEK_END) == 0)
+    size = ftell(file);
+  bool ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+  if (ok && size > 0) {
+    uint8_t *data = malloc((size_t)size);
+    ok = data && fread(data, 1, (size_t)size, file) == (size_t)size;
+    if (ok)
+      *s = (Stream){data, (size_t)size, (size_t)size, 0, false, false};
+    else
+      free(data);
+  }
+  fclose(file);
+  return ok;
+}
+
+#if defined(_WIN32)
+bool StreamMap(Stream *s, const char *path) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  bool ok = GetFileSizeEx(file, &size);
+  if (ok && size.QuadPart > 0) {
+    // the view keeps the mapping alive once both handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *data = NULL;
+    if (mapping) {
+      data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+    ok = data != NULL;
+    if (ok)
+      *s = (Stream){data, (size_t)size.QuadPart, 0, 0, false, true};
+  }
+  CloseHandle(file);
+  return ok;
+}
+#elif defined(STREAM_MMAP)
+bool StreamMap(Stream *s, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  struct stat st;
+  bool ok = fstat(fileno(file), &st) == 0;
+  if (ok && st.st_size > 0) {
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                      fileno(file), 0);
+    ok = data != MAP_FAILED;
+    if (ok)
+      *s = (Stream){data, (size_t)st.st_size, 0, 0, false, true};
+  }
+  fclose(file);
+  return ok;
+}
+#else
+bool StreamMap(Stream *s, const char *path) { return StreamLoad(s, path); }
+#endif
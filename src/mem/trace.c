@@ -0,0 +1,210 @@
+#include <mem/clock.h>
+#include <mem/trace.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// TraceGet/TraceSet access the fields of an event without ordering: the
+// sequence number of the event orders them (TraceClaim/TracePublish, the
+// fences and TraceAcquire), as in a seqlock.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef volatile LONG64 TraceCounter;
+
+#define TraceAdd(c, n) ((uint64_t)InterlockedExchangeAdd64(c, (LONG64)(n)))
+#define TraceLoad(c) ((uint64_t)InterlockedCompareExchange64(c, 0, 0))
+#define TraceStore(c, v) InterlockedExchange64(c, (LONG64)(v))
+#define TraceClaim(c, from, to)                                                \
+  ((uint64_t)InterlockedCompareExchange64(c, (LONG64)(to), (LONG64)(from)) ==  \
+   (from))
+#define TraceGet(c) ((uint64_t)ReadNoFence64(c))
+#define TraceSet(c, v) WriteNoFence64(c, (LONG64)(v))
+#define TraceAcquire(c) ((uint64_t)ReadAcquire64(c))
+#define TracePublish(c, v) WriteRelease64(c, (LONG64)(v))
+#define TraceFenceAcquire() MemoryBarrier()
+#define TraceFenceRelease() MemoryBarrier()
+#define TraceLocal __declspec(thread)
+#else
+#include <stdatomic.h>
+
+typedef _Atomic uint64_t TraceCounter;
+
+#define TraceAdd(c, n) atomic_fetch_add(c, n)
+#define TraceLoad(c) atomic_load(c)
+#define TraceStore(c, v) atomic_store(c, v)
+#define TraceClaim(c, from, to)                                                \
+  atomic_compare_exchange_strong_explicit(c, &(uint64_t){from}, to,            \
+                                          memory_order_acquire,                \
+                                          memory_order_relaxed)
+#define TraceGet(c) atomic_load_explicit(c, memory_order_relaxed)
+#define TraceSet(c, v) atomic_store_explicit(c, v, memory_order_relaxed)
+#define TraceAcquire(c) atomic_load_explicit(c, memory_order_acquire)
+#define TracePublish(c, v) atomic_store_explicit(c, v, memory_order_release)
+#define TraceFenceAcquire() atomic_thread_fence(memory_order_acquire)
+#define TraceFenceRelease() atomic_thread_fence(memory_order_release)
+#define TraceLocal _Thread_local
+#endif
+
+typedef struct {
+  TraceCounter seq;      ///< (index + 1) * 2, odd while being written
+  TraceCounter name;     ///< Name of the scope (pointer)
+  TraceCounter category; ///< Category of the scope (pointer)
+  TraceCounter start;    ///< Begin time (bits of the seconds, ClockWallTime())
+  TraceCounter duration; ///< Duration (bits of the seconds)
+  TraceCounter thread;   ///< Track of the thread that recorded it
+} TraceEvent;
+
+static uint64_t TraceBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(uint64_t));
+  return bits;
+}
+
+static double TraceSeconds(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(double));
+  return value;
+}
+
+struct Trace {
+  TraceEvent *events;     ///< Ring of events
+  size_t capacity;        ///< Number of events in the ring
+  TraceCounter next;      ///< Events claimed since the capture started
+  TraceCounter recording; ///< 1 while a capture is running
+  TraceCounter ended;     ///< Frames ended since the capture started
+  TraceCounter frames;    ///< Frames to record, 0 until TraceStop()
+  TraceCounter origin;    ///< Start time of the capture (bits of the seconds)
+};
+
+// Threads get a small track number the first time they record an event.
+static TraceCounter trace_threads;
+static TraceLocal uint32_t trace_thread;
+
+static uint32_t TraceThread(void) {
+  if (!trace_thread)
+    trace_thread = (uint32_t)TraceAdd(&trace_threads, 1) + 1;
+  return trace_thread;
+}
+
+Trace *TraceCreate(size_t capacity) {
+  if (capacity == 0)
+    return NULL;
+  Trace *trace = (Trace *)calloc(1, sizeof(Trace));
+  if (!trace)
+    return NULL;
+  trace->events = (TraceEvent *)calloc(capacity, sizeof(TraceEvent));
+  if (!trace->events) {
+    free(trace);
+    return NULL;
+  }
+  trace->capacity = capacity;
+  return trace;
+}
+
+void TraceFree(Trace *trace) {
+  if (!trace)
+    return;
+  free(trace->events);
+  free(trace);
+}
+
+void TraceCapture(Trace *trace, uint32_t frames) {
+  if (!trace)
+    return;
+  TraceStore(&trace->recording, 0);
+  for (size_t i = 0; i < trace->capacity; i++)
+    TraceStore(&trace->events[i].seq, 0);
+  TraceStore(&trace->next, 0);
+  TraceStore(&trace->ended, 0);
+  TraceStore(&trace->frames, frames);
+  TraceStore(&trace->origin, TraceBits(ClockWallTime()));
+  TraceStore(&trace->recording, 1);
+}
+
+void TraceStop(Trace *trace) {
+  if (trace)
+    TraceStore(&trace->recording, 0);
+}
+
+bool TraceRecording(Trace *trace) {
+  return trace && TraceLoad(&trace->recording);
+}
+
+void TraceFrame(Trace *trace) {
+  if (!TraceRecording(trace))
+    return;
+  uint64_t frames = TraceLoad(&trace->frames);
+  if (!frames)
+    return;
+  // the frame after the last recorded one starts
+  if (TraceAdd(&trace->ended, 1) + 1 > frames)
+    TraceStop(trace);
+}
+
+double TraceBegin(Trace *trace) {
+  return TraceRecording(trace) ? ClockWallTime() : 0;
+}
+
+void TraceEnd(Trace *trace, const char *name, const char *category,
+              double start) {
+  // scopes begun before the capture started are dropped
+  if (!TraceRecording(trace) ||
+      start < TraceSeconds(TraceLoad(&trace->origin)))
+    return;
+  double end = ClockWallTime();
+
+  // a writer a whole ring ahead or behind may hold the same slot: the slot is
+  // claimed with an odd sequence, and the event dropped if that fails
+  uint64_t index = TraceAdd(&trace->next, 1), seq = (index + 1) * 2;
+  TraceEvent *e = &trace->events[index % trace->capacity];
+  uint64_t held = TraceAcquire(&e->seq);
+  if (held & 1 || held >= seq || !TraceClaim(&e->seq, held, seq - 1))
+    return;
+  // readers that see any new field also see the slot as being written
+  TraceFenceRelease();
+  TraceSet(&e->name, (uintptr_t)name);
+  TraceSet(&e->category, (uintptr_t)category);
+  TraceSet(&e->start, TraceBits(start));
+  TraceSet(&e->duration, TraceBits(end - start));
+  TraceSet(&e->thread, TraceThread());
+  TracePublish(&e->seq, seq);
+}
+
+bool TraceDump(Trace *trace, Stream *out) {
+  if (!trace)
+    return false;
+
+  uint64_t next = TraceLoad(&trace->next);
+  uint64_t first = next > trace->capacity ? next - trace->capacity : 0;
+  double origin = TraceSeconds(TraceLoad(&trace->origin));
+  bool comma = false;
+
+  StreamPrintf(out, "{\"traceEvents\":[");
+  for (uint64_t i = first; i < next; i++) {
+    TraceEvent *slot = &trace->events[i % trace->capacity];
+    uint64_t seq = (i + 1) * 2;
+    if (TraceAcquire(&slot->seq) != seq)
+      continue;
+    const char *name = (const char *)(uintptr_t)TraceGet(&slot->name);
+    const char *category = (const char *)(uintptr_t)TraceGet(&slot->category);
+    double start = TraceSeconds(TraceGet(&slot->start));
+    double duration = TraceSeconds(TraceGet(&slot->duration));
+    uint32_t thread = (uint32_t)TraceGet(&slot->thread);
+    TraceFenceAcquire();
+    if (TraceGet(&slot->seq) != seq)
+      continue; // overwritten while copied
+    StreamPrintf(out, "%s\n{\"name\":", comma ? "," : "");
+    StreamPrintJson(out, name);
+    StreamPrintf(out, ",\"cat\":");
+    StreamPrintJson(out, category);
+    StreamPrintf(out,
+                 ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+                 "\"tid\":%u}",
+                 (start - origin) * 1e6, duration * 1e6, thread);
+    comma = true;
+  }
+  StreamPrintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return !out->failed;
+}